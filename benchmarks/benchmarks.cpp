@@ -0,0 +1,612 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_search_server.h"
+#include "durable_search_server.h"
+#include "metrics.h"
+#include "near_duplicates.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "thread_pool.h"
+#include "../tests/words_generator.h"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct BenchmarkOptions {
+    size_t document_count = 20'000;
+    size_t vocabulary_size = 10'000;
+    size_t max_word_length = 10;
+    size_t document_word_count = 70;
+    size_t query_count = 2'000;
+    size_t query_word_count = 7;
+    double minus_word_probability = 0.1;
+    size_t thread_count = max(1u, thread::hardware_concurrency());
+    size_t repetitions = 5;
+    unsigned seed = 0;
+    // runs only the benchmarks whose names contain it
+    string filter;
+    // "-" writes the report to the standard output
+    string json_path;
+};
+
+struct Corpus {
+    vector<string> dictionary;
+    vector<string> texts;
+    // the texts are viewed by the documents
+    vector<DocumentToAdd> documents;
+    vector<string> queries;
+};
+
+// Each run prepares what it needs and returns the duration of the measured part only
+struct Benchmark {
+    string name;
+    // documents, queries or matches handled by one run
+    size_t items;
+    function<Clock::duration()> run;
+};
+
+struct Summary {
+    string name;
+    size_t items = 0;
+    vector<double> milliseconds;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double median = 0.0;
+    double stddev = 0.0;
+    double items_per_second = 0.0;
+};
+
+void PrintUsage(ostream& out) {
+    out << "Usage: search_server_benchmarks [--help] [--documents=N] [--vocabulary=N] [--word-length=N]\n"
+           "       [--document-words=N] [--queries=N] [--query-words=N] [--minus-probability=P]\n"
+           "       [--threads=N] [--repetitions=N] [--seed=N] [--filter=SUBSTRING] [--json=PATH|-]\n";
+}
+
+BenchmarkOptions ParseOptions(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        const size_t equals = argument.find('=');
+        const string name = argument.substr(0, equals);
+        const string value = equals == string::npos ? ""s : argument.substr(equals + 1);
+        const auto number = [&]() -> size_t {
+            size_t parsed = 0;
+            const size_t result = stoul(value, &parsed);
+            if (parsed != value.size()) {
+                throw invalid_argument("Not a number: "s + argument);
+            }
+            return result;
+        };
+        if (name == "--help") {
+            PrintUsage(cout);
+            exit(0);
+        } else if (name == "--documents") {
+            options.document_count = number();
+        } else if (name == "--vocabulary") {
+            options.vocabulary_size = number();
+        } else if (name == "--word-length") {
+            options.max_word_length = number();
+        } else if (name == "--document-words") {
+            options.document_word_count = number();
+        } else if (name == "--queries") {
+            options.query_count = number();
+        } else if (name == "--query-words") {
+            options.query_word_count = number();
+        } else if (name == "--minus-probability") {
+            options.minus_word_probability = stod(value);
+        } else if (name == "--threads") {
+            options.thread_count = max<size_t>(number(), 1);
+        } else if (name == "--repetitions") {
+            options.repetitions = max<size_t>(number(), 1);
+        } else if (name == "--seed") {
+            options.seed = static_cast<unsigned>(number());
+        } else if (name == "--filter") {
+            options.filter = value;
+        } else if (name == "--json") {
+            options.json_path = value.empty() ? "-"s : value;
+        } else {
+            throw invalid_argument("Unknown option: "s + argument);
+        }
+    }
+    // the benchmarks cycle through the documents and the queries, and the near copies
+    // replace words by ones other than the first, which is the stop word
+    if (options.document_count == 0) {
+        throw invalid_argument("--documents must be at least 1"s);
+    }
+    if (options.query_count == 0) {
+        throw invalid_argument("--queries must be at least 1"s);
+    }
+    if (options.vocabulary_size < 2) {
+        throw invalid_argument("--vocabulary must be at least 2"s);
+    }
+    if (options.max_word_length == 0) {
+        throw invalid_argument("--word-length must be at least 1"s);
+    }
+    return options;
+}
+
+Corpus GenerateCorpus(const BenchmarkOptions& options) {
+    mt19937 generator(options.seed);
+    Corpus corpus;
+    corpus.dictionary = GenerateDictionary(generator, static_cast<int>(options.vocabulary_size),
+                                           static_cast<int>(options.max_word_length));
+    corpus.texts = GenerateQueries(generator, corpus.dictionary, static_cast<int>(options.document_count),
+                                   static_cast<int>(options.document_word_count));
+    for (size_t i = 0; i < corpus.texts.size(); ++i) {
+        corpus.documents.push_back({static_cast<int>(i), corpus.texts[i], DocumentStatus::ACTUAL,
+                                    {static_cast<int>(i % 10), 5}});
+    }
+    for (size_t i = 0; i < options.query_count; ++i) {
+        corpus.queries.push_back(GenerateQuery(generator, corpus.dictionary, static_cast<int>(options.query_word_count),
+                                               options.minus_word_probability));
+    }
+    return corpus;
+}
+
+SearchServer BuildServer(const Corpus& corpus) {
+    SearchServer search_server(corpus.dictionary.front());
+    search_server.AddDocuments(execution::par, corpus.documents);
+    return search_server;
+}
+
+// The corpus with every fourth text replaced by a shuffled copy of the text three before it,
+// a tenth of its words changed; such pairs are above the default similarity threshold
+vector<string> GenerateNearCopies(const Corpus& corpus) {
+    vector<string> texts = corpus.texts;
+    mt19937 generator(static_cast<unsigned>(texts.size()));
+    uniform_int_distribution<size_t> word_index(1, corpus.dictionary.size() - 1);
+    for (size_t i = 3; i < texts.size(); i += 4) {
+        vector<string_view> words = SplitIntoWordsStrView(corpus.texts[i - 3]);
+        for (size_t change = 0; change < words.size() / 10; ++change) {
+            words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] =
+                    corpus.dictionary[word_index(generator)];
+        }
+        shuffle(words.begin(), words.end(), generator);
+        string& text = texts[i];
+        text.clear();
+        for (const string_view word : words) {
+            if (!text.empty()) {
+                text += ' ';
+            }
+            text += word;
+        }
+    }
+    return texts;
+}
+
+template <typename Function>
+Clock::duration Measure(Function function) {
+    const auto start = Clock::now();
+    function();
+    return Clock::now() - start;
+}
+
+// Keeps the compiler from dropping the results
+volatile size_t sink = 0;
+
+vector<Benchmark> MakeBenchmarks(const BenchmarkOptions& options, const Corpus& corpus) {
+    vector<Benchmark> benchmarks;
+    const size_t document_count = corpus.documents.size();
+    const size_t query_count = corpus.queries.size();
+
+    benchmarks.push_back({"AddDocument", document_count, [&corpus] {
+        SearchServer search_server(corpus.dictionary.front());
+        return Measure([&] {
+            for (const DocumentToAdd& document : corpus.documents) {
+                search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+            }
+        });
+    }});
+    benchmarks.push_back({"AddDocuments/seq", document_count, [&corpus] {
+        SearchServer search_server(corpus.dictionary.front());
+        return Measure([&] {
+            search_server.AddDocuments(execution::seq, corpus.documents);
+        });
+    }});
+    benchmarks.push_back({"AddDocuments/par", document_count, [&corpus] {
+        SearchServer search_server(corpus.dictionary.front());
+        return Measure([&] {
+            search_server.AddDocuments(execution::par, corpus.documents);
+        });
+    }});
+
+    auto server = make_shared<SearchServer>(BuildServer(corpus));
+    benchmarks.push_back({"FindTopDocuments/seq", query_count, [&corpus, server] {
+        return Measure([&] {
+            for (const string& query : corpus.queries) {
+                sink = sink + server->FindTopDocuments(execution::seq, query).size();
+            }
+        });
+    }});
+    benchmarks.push_back({"FindTopDocuments/par", query_count, [&corpus, server] {
+        return Measure([&] {
+            for (const string& query : corpus.queries) {
+                sink = sink + server->FindTopDocuments(execution::par, query).size();
+            }
+        });
+    }});
+    benchmarks.push_back({"FindTopDocuments/wand", query_count, [&corpus, server] {
+        return Measure([&] {
+            for (const string& query : corpus.queries) {
+                sink = sink + server->FindTopDocuments(wand, query).size();
+            }
+        });
+    }});
+    benchmarks.push_back({"FindTopDocuments/metrics", query_count, [&corpus, server] {
+        Metrics::SetEnabled(true);
+        const auto duration = Measure([&] {
+            for (const string& query : corpus.queries) {
+                sink = sink + server->FindTopDocuments(execution::seq, query).size();
+            }
+        });
+        Metrics::SetEnabled(false);
+        Metrics::Reset();
+        return duration;
+    }});
+
+    // a few hundred queries make up most of the load, the case the result cache is for
+    auto repeated_queries = make_shared<vector<string>>();
+    {
+        const size_t distinct_count = min<size_t>(500, query_count);
+        vector<double> weights;
+        for (size_t rank = 1; rank <= distinct_count; ++rank) {
+            weights.push_back(1.0 / static_cast<double>(rank));
+        }
+        discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+        mt19937 generator(static_cast<unsigned>(query_count));
+        for (size_t i = 0; i < query_count; ++i) {
+            repeated_queries->push_back(corpus.queries[zipf(generator)]);
+        }
+    }
+    benchmarks.push_back({"FindTopDocuments/repeated", query_count, [server, repeated_queries] {
+        return Measure([&] {
+            for (const string& query : *repeated_queries) {
+                sink = sink + server->FindTopDocuments(execution::seq, query).size();
+            }
+        });
+    }});
+    // every run starts with an empty cache
+    benchmarks.push_back({"FindTopDocuments/cached", query_count, [server, repeated_queries] {
+        server->SetResultCacheCapacity(1'000);
+        const auto duration = Measure([&] {
+            for (const string& query : *repeated_queries) {
+                sink = sink + server->FindTopDocuments(execution::seq, query).size();
+            }
+        });
+        server->SetResultCacheCapacity(0);
+        return duration;
+    }});
+    benchmarks.push_back({"MatchDocument/seq", query_count, [&corpus, server, document_count] {
+        return Measure([&] {
+            for (size_t i = 0; i < corpus.queries.size(); ++i) {
+                const auto [words, status] = server->MatchDocument(execution::seq, corpus.queries[i],
+                                                                   static_cast<int>(i % document_count));
+                sink = sink + words.size();
+            }
+        });
+    }});
+    benchmarks.push_back({"MatchDocument/par", query_count, [&corpus, server, document_count] {
+        return Measure([&] {
+            for (size_t i = 0; i < corpus.queries.size(); ++i) {
+                const auto [words, status] = server->MatchDocument(execution::par, corpus.queries[i],
+                                                                   static_cast<int>(i % document_count));
+                sink = sink + words.size();
+            }
+        });
+    }});
+    benchmarks.push_back({"ProcessQueries", query_count, [&corpus, server] {
+        return Measure([&] {
+            sink = sink + ProcessQueries(*server, corpus.queries).size();
+        });
+    }});
+    benchmarks.push_back({"ProcessQueriesJoined", query_count, [&corpus, server] {
+        return Measure([&] {
+            sink = sink + ProcessQueriesJoined(*server, corpus.queries).size();
+        });
+    }});
+    // four clients submit the queries at once and the front end answers them on its threads
+    benchmarks.push_back({"AsyncFindTop", query_count, [&corpus, server, &options] {
+        static constexpr size_t CLIENT_COUNT = 4;
+        AsyncSearchOptions async_options;
+        async_options.thread_count = options.thread_count;
+        atomic<size_t> total = 0;
+        const auto duration = Measure([&] {
+            AsyncSearchServer async_server(*server, async_options);
+            vector<thread> clients;
+            for (size_t client = 0; client < CLIENT_COUNT; ++client) {
+                clients.emplace_back([&, client] {
+                    for (size_t i = client; i < corpus.queries.size(); i += CLIENT_COUNT) {
+                        async_server.SubmitFindTop(corpus.queries[i], DocumentStatus::ACTUAL,
+                                                   [&total](vector<Document> documents, exception_ptr) {
+                            total.fetch_add(documents.size(), memory_order_relaxed);
+                        });
+                    }
+                });
+            }
+            for (thread& client : clients) {
+                client.join();
+            }
+            // the destructor waits for the queued queries
+        });
+        sink = sink + total.load();
+        return duration;
+    }});
+
+    // every tenth document is removed
+    const size_t removed_count = (document_count + 9) / 10;
+    benchmarks.push_back({"RemoveDocument/seq", removed_count, [&corpus] {
+        SearchServer search_server = BuildServer(corpus);
+        return Measure([&] {
+            for (size_t id = 0; id < corpus.documents.size(); id += 10) {
+                search_server.RemoveDocument(execution::seq, static_cast<int>(id));
+            }
+        });
+    }});
+    benchmarks.push_back({"RemoveDocument/par", removed_count, [&corpus] {
+        SearchServer search_server = BuildServer(corpus);
+        return Measure([&] {
+            for (size_t id = 0; id < corpus.documents.size(); id += 10) {
+                search_server.RemoveDocument(execution::par, static_cast<int>(id));
+            }
+        });
+    }});
+
+    // four writers wait for fsyncs, which take so long that a slice of the corpus is enough;
+    // with a delay the writers starting a group commit wait for the others to join it
+    const size_t durable_count = min<size_t>(document_count, 2'000);
+    for (const int delay : {0, 500}) {
+        benchmarks.push_back({"DurableAddDocument/delay="s + to_string(delay) + "us"s, durable_count,
+                              [&corpus, durable_count, delay] {
+            static constexpr size_t WRITER_COUNT = 4;
+            const auto directory = filesystem::temp_directory_path()
+                                   / ("search_server_benchmark_"s + to_string(delay));
+            filesystem::remove_all(directory);
+            WriteAheadLogOptions options;
+            options.group_commit_delay = chrono::microseconds(delay);
+            DurableSearchServer search_server(corpus.dictionary.front(), directory.string(), options);
+            const auto duration = Measure([&] {
+                vector<thread> writers;
+                for (size_t writer = 0; writer < WRITER_COUNT; ++writer) {
+                    writers.emplace_back([&, writer] {
+                        for (size_t i = writer; i < durable_count; i += WRITER_COUNT) {
+                            const DocumentToAdd& document = corpus.documents[i];
+                            search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+                        }
+                    });
+                }
+                for (thread& writer : writers) {
+                    writer.join();
+                }
+            });
+            filesystem::remove_all(directory);
+            return duration;
+        }});
+    }
+
+    // a quarter of the documents repeat the words of another one in a different order
+    benchmarks.push_back({"RemoveDuplicates", document_count, [&corpus] {
+        vector<DocumentToAdd> documents = corpus.documents;
+        vector<string> texts;
+        texts.reserve(documents.size() / 4 + 1);
+        mt19937 generator(static_cast<unsigned>(documents.size()));
+        for (size_t i = 3; i < documents.size(); i += 4) {
+            vector<string_view> words = SplitIntoWordsStrView(corpus.documents[i - 3].text);
+            shuffle(words.begin(), words.end(), generator);
+            string& text = texts.emplace_back();
+            for (const string_view word : words) {
+                if (!text.empty()) {
+                    text += ' ';
+                }
+                text += word;
+            }
+            documents[i].text = text;
+        }
+        SearchServer search_server(corpus.dictionary.front());
+        search_server.AddDocuments(execution::par, documents);
+
+        // the duplicates found are reported to cout, which is muted while measuring
+        ostringstream muted;
+        auto* const buffer = cout.rdbuf(muted.rdbuf());
+        const auto duration = Measure([&] {
+            RemoveDuplicates(search_server);
+        });
+        cout.rdbuf(buffer);
+        return duration;
+    }});
+
+    const vector<string> near_copies = GenerateNearCopies(corpus);
+    auto near_copies_server = make_shared<SearchServer>(corpus.dictionary.front());
+    for (size_t i = 0; i < near_copies.size(); ++i) {
+        near_copies_server->AddDocument(static_cast<int>(i), near_copies[i], DocumentStatus::ACTUAL, {1});
+    }
+    benchmarks.push_back({"NearDuplicates/seq", document_count, [near_copies_server] {
+        const NearDuplicateFinder finder;
+        return Measure([&] {
+            sink = sink + finder.FindClusters(execution::seq, *near_copies_server).size();
+        });
+    }});
+    benchmarks.push_back({"NearDuplicates/par", document_count, [near_copies_server] {
+        const NearDuplicateFinder finder;
+        return Measure([&] {
+            sink = sink + finder.FindClusters(execution::par, *near_copies_server).size();
+        });
+    }});
+    return benchmarks;
+}
+
+Summary Summarize(const Benchmark& benchmark, vector<double> milliseconds) {
+    Summary summary;
+    summary.name = benchmark.name;
+    summary.items = benchmark.items;
+    summary.milliseconds = milliseconds;
+
+    sort(milliseconds.begin(), milliseconds.end());
+    const size_t count = milliseconds.size();
+    summary.min = milliseconds.front();
+    summary.max = milliseconds.back();
+    summary.median = count % 2 == 1
+                     ? milliseconds[count / 2]
+                     : (milliseconds[count / 2 - 1] + milliseconds[count / 2]) / 2;
+    for (const double value : milliseconds) {
+        summary.mean += value;
+    }
+    summary.mean /= static_cast<double>(count);
+    if (count > 1) {
+        double squares = 0.0;
+        for (const double value : milliseconds) {
+            squares += (value - summary.mean) * (value - summary.mean);
+        }
+        summary.stddev = sqrt(squares / static_cast<double>(count - 1));
+    }
+    if (summary.median > 0.0) {
+        summary.items_per_second = static_cast<double>(summary.items) * 1000.0 / summary.median;
+    }
+    return summary;
+}
+
+string EscapeJson(string_view text) {
+    string escaped;
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            ostringstream code;
+            code << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c);
+            escaped += code.str();
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void WriteJson(ostream& out, const BenchmarkOptions& options, const vector<Summary>& summaries) {
+    out << setprecision(6) << fixed;
+    out << "{\n"
+        << "  \"context\": {\n"
+        << "    \"compiler\": \"" << EscapeJson(__VERSION__) << "\",\n"
+#ifdef SEARCH_SERVER_BUILD_TYPE
+        << "    \"build_type\": \"" << EscapeJson(SEARCH_SERVER_BUILD_TYPE) << "\",\n"
+#endif
+#ifdef NDEBUG
+        << "    \"assertions\": false,\n"
+#else
+        << "    \"assertions\": true,\n"
+#endif
+        << "    \"documents\": " << options.document_count << ",\n"
+        << "    \"vocabulary\": " << options.vocabulary_size << ",\n"
+        << "    \"word_length\": " << options.max_word_length << ",\n"
+        << "    \"document_words\": " << options.document_word_count << ",\n"
+        << "    \"queries\": " << options.query_count << ",\n"
+        << "    \"query_words\": " << options.query_word_count << ",\n"
+        << "    \"minus_probability\": " << options.minus_word_probability << ",\n"
+        << "    \"threads\": " << options.thread_count << ",\n"
+        << "    \"repetitions\": " << options.repetitions << ",\n"
+        << "    \"seed\": " << options.seed << "\n"
+        << "  },\n"
+        << "  \"benchmarks\": [";
+    for (size_t i = 0; i < summaries.size(); ++i) {
+        const Summary& summary = summaries[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\n"
+            << "      \"name\": \"" << EscapeJson(summary.name) << "\",\n"
+            << "      \"items\": " << summary.items << ",\n"
+            << "      \"runs_ms\": [";
+        for (size_t run = 0; run < summary.milliseconds.size(); ++run) {
+            out << (run == 0 ? "" : ", ") << summary.milliseconds[run];
+        }
+        out << "],\n"
+            << "      \"min_ms\": " << summary.min << ",\n"
+            << "      \"median_ms\": " << summary.median << ",\n"
+            << "      \"mean_ms\": " << summary.mean << ",\n"
+            << "      \"stddev_ms\": " << summary.stddev << ",\n"
+            << "      \"max_ms\": " << summary.max << ",\n"
+            << "      \"items_per_second\": " << summary.items_per_second << "\n"
+            << "    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void PrintSummary(ostream& out, const Summary& summary) {
+    out << left << setw(32) << summary.name << right << fixed << setprecision(3)
+        << " median " << setw(10) << summary.median << " ms"
+        << "  mean " << setw(10) << summary.mean << " ms"
+        << "  stddev " << setw(8) << summary.stddev << " ms"
+        << "  min " << setw(10) << summary.min << " ms"
+        << "  " << setprecision(0) << setw(12) << summary.items_per_second << " items/s" << endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage(cerr);
+        return 1;
+    }
+
+    ThreadPoolOptions pool_options;
+    pool_options.thread_count = options.thread_count;
+    ThreadPool::ConfigureDefault(pool_options);
+
+    const Corpus corpus = GenerateCorpus(options);
+    // the generator drops repeated words, short words may leave fewer than asked for
+    if (corpus.dictionary.size() < 2) {
+        cerr << "The vocabulary has fewer than 2 distinct words, raise --vocabulary or --word-length" << endl;
+        PrintUsage(cerr);
+        return 1;
+    }
+    // the report goes to stdout as JSON, so the table is moved out of its way
+    ostream& log = options.json_path == "-" ? cerr : cout;
+
+    vector<Summary> summaries;
+    for (const Benchmark& benchmark : MakeBenchmarks(options, corpus)) {
+        if (benchmark.name.find(options.filter) == string::npos) {
+            continue;
+        }
+        // one run to warm the caches and the allocator, it is not counted
+        benchmark.run();
+        vector<double> milliseconds;
+        for (size_t i = 0; i < options.repetitions; ++i) {
+            milliseconds.push_back(chrono::duration<double, milli>(benchmark.run()).count());
+        }
+        summaries.push_back(Summarize(benchmark, move(milliseconds)));
+        PrintSummary(log, summaries.back());
+    }
+
+    if (options.json_path == "-") {
+        WriteJson(cout, options, summaries);
+    } else if (!options.json_path.empty()) {
+        ofstream out(options.json_path);
+        WriteJson(out, options, summaries);
+        if (!out) {
+            cerr << "Can't write " << options.json_path << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only view of count elements stored elsewhere, in a vector or in a mapped file
+template <typename T>
+class ArrayView {
+public:
+    ArrayView() = default;
+
+    ArrayView(const T* data, size_t size) : data_(data), size_(size) {
+    }
+
+    const T& operator[](size_t index) const {
+        return data_[index];
+    }
+
+    const T* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    const T* begin() const {
+        return data_;
+    }
+
+    const T* end() const {
+        return data_ + size_;
+    }
+
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,95 @@
+#include "async_search_server.h"
+
+#include <stdexcept>
+
+namespace {
+
+std::exception_ptr MakeStoppedError() {
+    return std::make_exception_ptr(std::runtime_error("AsyncSearchServer is stopped"));
+}
+
+}
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, AsyncSearchOptions options)
+        : search_server_(search_server)
+        , requests_(options.queue_capacity) {
+    const size_t thread_count = std::max<size_t>(options.thread_count, 1);
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back(&AsyncSearchServer::ThreadMain, this);
+    }
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+    requests_.Close();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::SubmitFindTop(std::string query, DocumentStatus status) {
+    Request request{std::move(query), status, {}, std::promise<std::vector<Document>>()};
+    auto result = request.promise->get_future();
+    if (!requests_.Push(request)) {
+        request.promise->set_exception(MakeStoppedError());
+    }
+    return result;
+}
+
+void AsyncSearchServer::SubmitFindTop(std::string query, DocumentStatus status, Callback callback) {
+    Request request{std::move(query), status, std::move(callback), {}};
+    if (!requests_.Push(request)) {
+        request.callback({}, MakeStoppedError());
+    }
+}
+
+std::optional<std::future<std::vector<Document>>> AsyncSearchServer::TrySubmitFindTop(std::string query,
+                                                                                      DocumentStatus status) {
+    Request request{std::move(query), status, {}, std::promise<std::vector<Document>>()};
+    auto result = request.promise->get_future();
+    if (!requests_.TryPush(request)) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+bool AsyncSearchServer::TrySubmitFindTop(std::string query, DocumentStatus status, Callback callback) {
+    Request request{std::move(query), status, std::move(callback), {}};
+    return requests_.TryPush(request);
+}
+
+size_t AsyncSearchServer::GetThreadCount() const {
+    return threads_.size();
+}
+
+size_t AsyncSearchServer::GetQueueCapacity() const {
+    return requests_.GetCapacity();
+}
+
+void AsyncSearchServer::ThreadMain() {
+    Request request;
+    while (requests_.Pop(request)) {
+        Answer(request);
+        // the next Pop moves the query in, the rest must not outlive the answer
+        request.callback = nullptr;
+        request.promise.reset();
+    }
+}
+
+void AsyncSearchServer::Answer(Request& request) const {
+    std::vector<Document> documents;
+    std::exception_ptr error;
+    try {
+        documents = search_server_.FindTopDocuments(request.query, request.status);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    if (request.callback) {
+        request.callback(std::move(documents), error);
+    } else if (error) {
+        request.promise->set_exception(error);
+    } else {
+        request.promise->set_value(std::move(documents));
+    }
+}
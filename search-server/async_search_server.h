@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "document.h"
+#include "search_server.h"
+
+struct AsyncSearchOptions {
+    // threads answering queries
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    // queries waiting for a thread, rounded up to a power of two
+    size_t queue_capacity = 1024;
+};
+
+// Front end answering FindTopDocuments on its own threads. Queries wait in a bounded
+// queue: Submit blocks the caller while it is full, TrySubmit refuses the query instead,
+// so a burst of clients slows down or gets rejected rather than growing the backlog.
+// The server must not be changed while the front end is alive.
+class AsyncSearchServer {
+public:
+    // Gets the top or the exception FindTopDocuments threw, on one of the search threads; must not throw
+    using Callback = std::function<void(std::vector<Document> documents, std::exception_ptr error)>;
+
+    explicit AsyncSearchServer(const SearchServer& search_server, AsyncSearchOptions options = {});
+
+    AsyncSearchServer(const AsyncSearchServer&) = delete;
+    AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+    // Answers the queries already submitted, then stops the threads
+    ~AsyncSearchServer();
+
+    // Once the destructor has started, the future or the callback, on the calling thread,
+    // gets std::runtime_error instead of the top
+    std::future<std::vector<Document>> SubmitFindTop(std::string query,
+                                                     DocumentStatus status = DocumentStatus::ACTUAL);
+    void SubmitFindTop(std::string query, DocumentStatus status, Callback callback);
+
+    // Nothing if the queue is full or the destructor has started
+    std::optional<std::future<std::vector<Document>>> TrySubmitFindTop(std::string query,
+                                                                       DocumentStatus status = DocumentStatus::ACTUAL);
+    bool TrySubmitFindTop(std::string query, DocumentStatus status, Callback callback);
+
+    size_t GetThreadCount() const;
+    size_t GetQueueCapacity() const;
+
+private:
+    struct Request {
+        std::string query;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        // either of them; a promise allocates its shared state, so only the queries
+        // answered through a future have one, and a default request costs no allocation
+        Callback callback;
+        std::optional<std::promise<std::vector<Document>>> promise;
+    };
+
+    const SearchServer& search_server_;
+    BoundedQueue<Request> requests_;
+    std::vector<std::thread> threads_;
+
+    void ThreadMain();
+    void Answer(Request& request) const;
+};
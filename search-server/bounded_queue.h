@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Bounded multi-producer multi-consumer queue on a ring of cells (D. Vyukov's scheme).
+// Every cell has a sequence number telling whose turn it is: a producer may fill it
+// when it equals the enqueue position, a consumer may empty it when it is one more.
+// TryPush and TryPop take no locks; Push and Pop sleep on a condition variable while
+// the queue is full or empty, the other side wakes them only if someone sleeps.
+// Pushes under way count themselves, so that a push racing with Close is either
+// refused or popped, never left in the queue after the consumers are gone.
+template <typename T>
+class BoundedQueue {
+public:
+    // The capacity is rounded up to a power of two
+    explicit BoundedQueue(size_t capacity);
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    size_t GetCapacity() const {
+        return mask_ + 1;
+    }
+
+    // Moves from value only on success; false if the queue is full or closed
+    bool TryPush(T& value);
+
+    bool TryPop(T& value);
+
+    // Waits for room; false if the queue is closed
+    bool Push(T& value);
+
+    // Waits for a value; false once the queue is closed and empty
+    bool Pop(T& value);
+
+    // Pushes fail from now on; the values already queued and those of the pushes
+    // under way can still be popped
+    void Close();
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueue_position_{0};
+    alignas(64) std::atomic<size_t> dequeue_position_{0};
+
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::atomic<size_t> waiting_producers_{0};
+    std::atomic<size_t> waiting_consumers_{0};
+    std::atomic<bool> closed_{false};
+    std::atomic<size_t> pushing_{0};
+
+    bool TryPushWithoutWakeUp(T& value);
+    bool PushToCell(T& value);
+    bool TryPopWithoutWakeUp(T& value);
+    void WakeUp(const std::atomic<size_t>& waiting, std::condition_variable& condition);
+};
+
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+    cells_ = std::make_unique<Cell[]>(size);
+    mask_ = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+bool BoundedQueue<T>::TryPush(T& value) {
+    const bool pushed = TryPushWithoutWakeUp(value);
+    if (closed_.load(std::memory_order_seq_cst)) {
+        // consumers of a closed queue wait for the pushes under way, this one is over
+        {
+            std::lock_guard guard(mutex_);
+        }
+        not_empty_.notify_all();
+    } else if (pushed) {
+        WakeUp(waiting_consumers_, not_empty_);
+    }
+    return pushed;
+}
+
+template <typename T>
+bool BoundedQueue<T>::TryPop(T& value) {
+    if (!TryPopWithoutWakeUp(value)) {
+        return false;
+    }
+    WakeUp(waiting_producers_, not_full_);
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::Push(T& value) {
+    if (TryPush(value)) {
+        return true;
+    }
+    {
+        std::unique_lock lock(mutex_);
+        // announced before the last try: a consumer freeing a cell after it sees us waiting
+        waiting_producers_.fetch_add(1, std::memory_order_seq_cst);
+        bool pushed = false;
+        while (!closed_.load(std::memory_order_acquire) && !(pushed = TryPushWithoutWakeUp(value))) {
+            not_full_.wait(lock);
+        }
+        waiting_producers_.fetch_sub(1, std::memory_order_relaxed);
+        if (!pushed) {
+            return false;
+        }
+    }
+    WakeUp(waiting_consumers_, not_empty_);
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::Pop(T& value) {
+    if (TryPop(value)) {
+        return true;
+    }
+    {
+        std::unique_lock lock(mutex_);
+        waiting_consumers_.fetch_add(1, std::memory_order_seq_cst);
+        bool popped = false;
+        while (!(popped = TryPopWithoutWakeUp(value))) {
+            if (closed_.load(std::memory_order_seq_cst) && pushing_.load(std::memory_order_seq_cst) == 0) {
+                // a push that ended after the try has left its value
+                popped = TryPopWithoutWakeUp(value);
+                break;
+            }
+            not_empty_.wait(lock);
+        }
+        waiting_consumers_.fetch_sub(1, std::memory_order_relaxed);
+        if (!popped) {
+            return false;
+        }
+    }
+    WakeUp(waiting_producers_, not_full_);
+    return true;
+}
+
+template <typename T>
+void BoundedQueue<T>::Close() {
+    {
+        std::lock_guard guard(mutex_);
+        closed_.store(true, std::memory_order_seq_cst);
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+}
+
+template <typename T>
+bool BoundedQueue<T>::TryPushWithoutWakeUp(T& value) {
+    // announced before closed_ is read: either Close is seen here or Pop sees the push
+    pushing_.fetch_add(1, std::memory_order_seq_cst);
+    const bool pushed = !closed_.load(std::memory_order_seq_cst) && PushToCell(value);
+    pushing_.fetch_sub(1, std::memory_order_seq_cst);
+    return pushed;
+}
+
+template <typename T>
+bool BoundedQueue<T>::PushToCell(T& value) {
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &cells_[position & mask_];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // the cell still holds a value from the previous round
+            return false;
+        } else {
+            position = enqueue_position_.load(std::memory_order_relaxed);
+        }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::TryPopWithoutWakeUp(T& value) {
+    size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &cells_[position & mask_];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+        if (difference == 0) {
+            if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = dequeue_position_.load(std::memory_order_relaxed);
+        }
+    }
+    value = std::move(cell->value);
+    cell->value = T();
+    cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+void BoundedQueue<T>::WakeUp(const std::atomic<size_t>& waiting, std::condition_variable& condition) {
+    // pairs with the announcement of a waiter: either it sees our change or we see it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) != 0) {
+        {
+            std::lock_guard guard(mutex_);
+        }
+        condition.notify_one();
+    }
+}
@@ -0,0 +1,184 @@
+#include "compressed_postings.h"
+
+#include <algorithm>
+
+namespace {
+
+uint32_t ReadVarint(const uint8_t*& position) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*position & 0x80u) {
+        value |= static_cast<uint32_t>(*position++ & 0x7fu) << shift;
+        shift += 7;
+    }
+    return value | static_cast<uint32_t>(*position++) << shift;
+}
+
+// Same as ReadVarint, but stops at the end and at values longer than 32 bits
+bool ReadVarintChecked(const uint8_t*& position, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; position != end && shift < 35; shift += 7) {
+        const uint8_t byte = *position++;
+        if (shift == 28 && byte > 0x0fu) {
+            return false;
+        }
+        value |= static_cast<uint32_t>(byte & 0x7fu) << shift;
+        if (!(byte & 0x80u)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+CompressedPostings::Cursor::Cursor(const CompressedPostings& postings, size_t list)
+        : postings_(&postings),
+          first_block_(postings.list_offsets_[list].first_block),
+          last_block_(postings.list_offsets_[list + 1].first_block),
+          last_index_(postings.GetPostingCount(list)) {
+    if (!IsEnd()) {
+        position_ = postings_->bytes_.data() + postings_->blocks_[first_block_].byte_offset;
+        Decode();
+    }
+}
+
+void CompressedPostings::Cursor::Next() {
+    // blocks of a list follow each other, so the next posting is decoded right where we are
+    if (++index_ != last_index_) {
+        Decode();
+    }
+}
+
+void CompressedPostings::Cursor::Advance(uint32_t document) {
+    if (IsEnd() || document_ >= document) {
+        return;
+    }
+    const auto& blocks = postings_->blocks_;
+    const size_t block = first_block_ + index_ / BLOCK_SIZE;
+    if (blocks[block].last_document < document) {
+        const auto target = std::partition_point(blocks.begin() + block + 1, blocks.begin() + last_block_,
+                                                 [document](const Block& candidate) {
+                                                     return candidate.last_document < document;
+                                                 });
+        const size_t target_block = target - blocks.begin();
+        if (target_block == last_block_) {
+            index_ = last_index_;
+            return;
+        }
+        // gaps of a block start from the last document of the previous one
+        index_ = (target_block - first_block_) * BLOCK_SIZE;
+        position_ = postings_->bytes_.data() + target->byte_offset;
+        document_ = blocks[target_block - 1].last_document;
+        Decode();
+    }
+    while (!IsEnd() && document_ < document) {
+        Next();
+    }
+}
+
+void CompressedPostings::Cursor::Decode() {
+    document_ += ReadVarint(position_);
+    count_ = ReadVarint(position_);
+}
+
+CompressedPostings::CompressedPostings() : built_list_offsets_{{0, 0}} {
+    ViewBuiltLists();
+}
+
+CompressedPostings::CompressedPostings(ArrayView<uint8_t> bytes, ArrayView<Block> blocks,
+                                       ArrayView<ListOffset> list_offsets)
+        : bytes_(bytes),
+          blocks_(blocks),
+          list_offsets_(list_offsets) {
+}
+
+void CompressedPostings::AddList(const std::vector<Posting>& postings) {
+    uint32_t previous_document = 0;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if (i % BLOCK_SIZE == 0) {
+            built_blocks_.push_back({0, 0, built_bytes_.size()});
+        }
+        Write(postings[i].document - previous_document);
+        Write(postings[i].count);
+        built_blocks_.back().last_document = postings[i].document;
+        previous_document = postings[i].document;
+    }
+    built_list_offsets_.push_back({built_list_offsets_.back().posting_index + postings.size(), built_blocks_.size()});
+    ViewBuiltLists();
+}
+
+bool CompressedPostings::IsValid(size_t document_count) const {
+    if (list_offsets_.empty() || list_offsets_[0].posting_index != 0 || list_offsets_[0].first_block != 0
+        || list_offsets_[list_offsets_.size() - 1].first_block != blocks_.size()) {
+        return false;
+    }
+    for (size_t list = 0; list + 1 < list_offsets_.size(); ++list) {
+        const ListOffset& first = list_offsets_[list];
+        const ListOffset& last = list_offsets_[list + 1];
+        if (last.posting_index < first.posting_index || last.first_block < first.first_block
+            || last.first_block - first.first_block != (last.posting_index - first.posting_index + BLOCK_SIZE - 1) / BLOCK_SIZE) {
+            return false;
+        }
+    }
+    // blocks are stored one after another, so a block ends where the next one starts
+    for (size_t block = 0; block < blocks_.size(); ++block) {
+        const uint64_t end = block + 1 < blocks_.size() ? blocks_[block + 1].byte_offset : bytes_.size();
+        if (blocks_[block].byte_offset >= end || end > bytes_.size()
+            || blocks_[block].last_document >= document_count) {
+            return false;
+        }
+    }
+
+    for (size_t list = 0; list + 1 < list_offsets_.size(); ++list) {
+        size_t posting_count = GetPostingCount(list);
+        uint64_t document = 0;
+        for (size_t block = list_offsets_[list].first_block; block < list_offsets_[list + 1].first_block; ++block) {
+            const uint8_t* position = bytes_.data() + blocks_[block].byte_offset;
+            const uint8_t* const end = bytes_.data()
+                                       + (block + 1 < blocks_.size() ? blocks_[block + 1].byte_offset : bytes_.size());
+            for (size_t i = 0; i < BLOCK_SIZE && posting_count > 0; ++i, --posting_count) {
+                uint32_t gap;
+                uint32_t count;
+                // only the first document of a list may have a zero gap
+                if (!ReadVarintChecked(position, end, gap) || !ReadVarintChecked(position, end, count)
+                    || (gap == 0 && posting_count != GetPostingCount(list))) {
+                    return false;
+                }
+                document += gap;
+                if (document > blocks_[block].last_document) {
+                    return false;
+                }
+            }
+            if (position != end || document != blocks_[block].last_document) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t CompressedPostings::GetByteSize() const {
+    return bytes_.size() + blocks_.size() * sizeof(Block) + list_offsets_.size() * sizeof(ListOffset);
+}
+
+void CompressedPostings::ShrinkToFit() {
+    built_bytes_.shrink_to_fit();
+    built_blocks_.shrink_to_fit();
+    built_list_offsets_.shrink_to_fit();
+    ViewBuiltLists();
+}
+
+void CompressedPostings::Write(uint32_t value) {
+    while (value >= 0x80u) {
+        built_bytes_.push_back(static_cast<uint8_t>(value | 0x80u));
+        value >>= 7;
+    }
+    built_bytes_.push_back(static_cast<uint8_t>(value));
+}
+
+void CompressedPostings::ViewBuiltLists() {
+    bytes_ = {built_bytes_.data(), built_bytes_.size()};
+    blocks_ = {built_blocks_.data(), built_blocks_.size()};
+    list_offsets_ = {built_list_offsets_.data(), built_list_offsets_.size()};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "array_view.h"
+
+// Read-only posting lists packed into one byte array. Every posting is a variable-byte
+// gap from the previous document followed by the variable-byte number of occurrences
+// of the term in the document. Lists are cut into blocks of BLOCK_SIZE postings, and
+// a skip entry per block keeps its last document and byte offset, so Advance steps
+// over whole blocks without decoding them.
+// Lists are read through views, which point either to the lists built by AddList
+// or to arrays stored elsewhere, such as an index file.
+class CompressedPostings {
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    struct Posting {
+        uint32_t document;
+        uint32_t count;
+    };
+
+    // Skip entry, the layout is fixed as it is stored in index files
+    struct Block {
+        uint32_t last_document;
+        uint32_t reserved;
+        uint64_t byte_offset;
+    };
+
+    struct ListOffset {
+        uint64_t posting_index;
+        uint64_t first_block;
+    };
+
+    // Iterates one list in ascending document order
+    class Cursor {
+    public:
+        bool IsEnd() const {
+            return index_ == last_index_;
+        }
+
+        uint32_t GetDocument() const {
+            return document_;
+        }
+
+        uint32_t GetCount() const {
+            return count_;
+        }
+
+        void Next();
+
+        // Moves to the first posting with a document not less than the given one
+        void Advance(uint32_t document);
+
+    private:
+        friend class CompressedPostings;
+
+        Cursor(const CompressedPostings& postings, size_t list);
+
+        const CompressedPostings* postings_;
+        size_t first_block_;
+        size_t last_block_;
+        size_t index_ = 0;
+        size_t last_index_;
+        const uint8_t* position_ = nullptr;
+        uint32_t document_ = 0;
+        uint32_t count_ = 0;
+
+        void Decode();
+    };
+
+    CompressedPostings();
+
+    // Views lists stored elsewhere, the arrays must outlive the object
+    CompressedPostings(ArrayView<uint8_t> bytes, ArrayView<Block> blocks, ArrayView<ListOffset> list_offsets);
+
+    CompressedPostings(CompressedPostings&& other) noexcept = default;
+    CompressedPostings& operator=(CompressedPostings&& other) noexcept = default;
+
+    // Lists are numbered in the order they are added, documents must ascend
+    void AddList(const std::vector<Posting>& postings);
+
+    size_t GetListCount() const {
+        return list_offsets_.size() - 1;
+    }
+
+    size_t GetPostingCount(size_t list) const {
+        return list_offsets_[list + 1].posting_index - list_offsets_[list].posting_index;
+    }
+
+    Cursor Open(size_t list) const {
+        return Cursor(*this, list);
+    }
+
+    // Whether the lists, skip entries and encoded postings are consistent and all documents
+    // are less than document_count, so that cursors never read out of the arrays.
+    // Decodes every posting, which views of a damaged file need before they are read.
+    bool IsValid(size_t document_count) const;
+
+    // Bytes taken by the encoded postings and the skip entries
+    size_t GetByteSize() const;
+
+    void ShrinkToFit();
+
+    ArrayView<uint8_t> GetBytes() const {
+        return bytes_;
+    }
+
+    ArrayView<Block> GetBlocks() const {
+        return blocks_;
+    }
+
+    ArrayView<ListOffset> GetListOffsets() const {
+        return list_offsets_;
+    }
+
+private:
+    // lists built by AddList, moving the vectors keeps the views valid
+    std::vector<uint8_t> built_bytes_;
+    std::vector<Block> built_blocks_;
+    std::vector<ListOffset> built_list_offsets_;
+
+    ArrayView<uint8_t> bytes_;
+    ArrayView<Block> blocks_;
+    ArrayView<ListOffset> list_offsets_;
+
+    void Write(uint32_t value);
+
+    void ViewBuiltLists();
+};
@@ -3,58 +3,324 @@
 //
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
-#include <future>
+#include <cstring>
 #include <map>
-#include <numeric>
-#include <vector>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 
+// Hash map for integer keys split into shards, each shard being an open-addressing table
+// with linear probing guarded by its own mutex. Shards sit on separate cache lines.
+// Writers bump the shard version before and after a change (a seqlock), so Find reads
+// without taking the mutex and retries only if a write overlapped it. Tables replaced by
+// a rehash are kept until the map is destroyed, so an optimistic reader never touches
+// freed memory; growth by doubling bounds them by the size of the live tables.
+// Every slot field is an atomic, read and written with relaxed order inside the version
+// protocol, so a read racing with a write is well defined and only its copy is thrown away.
+// Values are kept as atomic words, hence they must be trivially copyable; a writer changes
+// a copy of the value that goes back to the slot when its Access ends.
 template <typename Key, typename Value>
 class ConcurrentMap {
-
 private:
-    struct MutexMap {
+    static_assert(std::is_trivially_copyable_v<Value>, "ConcurrentMap stores values as atomic words");
+    static_assert(std::is_default_constructible_v<Value>, "ConcurrentMap copies values into default ones");
+
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr size_t MIN_TABLE_SIZE = 16;
+    static constexpr size_t VALUE_WORD_COUNT = (sizeof(Value) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    struct Slot {
+        std::atomic<Key> key{};
+        std::atomic<bool> is_used{false};
+        std::atomic<uint64_t> value_words[VALUE_WORD_COUNT] = {};
+
+        Key GetKey() const {
+            return key.load(std::memory_order_relaxed);
+        }
+
+        bool IsUsed() const {
+            return is_used.load(std::memory_order_relaxed);
+        }
+
+        Value LoadValue() const {
+            uint64_t words[VALUE_WORD_COUNT];
+            for (size_t i = 0; i < VALUE_WORD_COUNT; ++i) {
+                words[i] = value_words[i].load(std::memory_order_relaxed);
+            }
+            Value value;
+            std::memcpy(&value, words, sizeof(Value));
+            return value;
+        }
+
+        void StoreValue(const Value& value) {
+            uint64_t words[VALUE_WORD_COUNT] = {};
+            std::memcpy(words, &value, sizeof(Value));
+            for (size_t i = 0; i < VALUE_WORD_COUNT; ++i) {
+                value_words[i].store(words[i], std::memory_order_relaxed);
+            }
+        }
+
+        void CopyFrom(const Slot& other) {
+            key.store(other.GetKey(), std::memory_order_relaxed);
+            is_used.store(other.IsUsed(), std::memory_order_relaxed);
+            for (size_t i = 0; i < VALUE_WORD_COUNT; ++i) {
+                value_words[i].store(other.value_words[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+
+        void Clear() {
+            key.store(Key{}, std::memory_order_relaxed);
+            is_used.store(false, std::memory_order_relaxed);
+            for (std::atomic<uint64_t>& word : value_words) {
+                word.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Table {
+        explicit Table(size_t size) : slots(size) {
+        }
+
+        std::vector<Slot> slots;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Shard {
         std::mutex m_;
-        std::map<Key, Value> map_;
+        std::atomic<uint64_t> version_{0};
+        std::atomic<Table*> table_{nullptr};
+        size_t size_ = 0;
+        std::vector<std::unique_ptr<Table>> tables_;
+    };
+
+    std::vector<Shard> vector_;
+
+    // Keeps the shard version odd while it lives, also when the change throws
+    class WriteGuard {
+    public:
+        explicit WriteGuard(Shard& shard) : shard_(shard) {
+            shard_.version_.fetch_add(1, std::memory_order_acq_rel);
+        }
+
+        ~WriteGuard() {
+            shard_.version_.fetch_add(1, std::memory_order_release);
+        }
+
+        WriteGuard(const WriteGuard&) = delete;
+        WriteGuard& operator=(const WriteGuard&) = delete;
+
+    private:
+        Shard& shard_;
     };
-    std::vector<MutexMap> vector_;
 
 public:
     static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys");
 
+    // Holds the shard locked and marked as being written while the value is in use;
+    // ref_to_value is a copy of the value, stored back into the slot at the end
     struct Access {
         std::lock_guard<std::mutex> guard;
         Value& ref_to_value;
 
-        Access(const Key& key, MutexMap& map) :
-                guard(map.m_),
-                ref_to_value(map.map_[key]) {
+        Access(const Key& key, Shard& shard) :
+                guard(shard.m_),
+                ref_to_value(value_),
+                shard_(shard),
+                slot_(BeginWrite(shard, key)),
+                value_(slot_->LoadValue()) {
+        }
+
+        ~Access() {
+            slot_->StoreValue(value_);
+            shard_.version_.fetch_add(1, std::memory_order_release);
+        }
+
+        Access(const Access&) = delete;
+        Access& operator=(const Access&) = delete;
+
+    private:
+        Shard& shard_;
+        Slot* slot_;
+        Value value_;
+
+        // the table grows before the version turns odd, so a failed allocation leaves it even
+        static Slot* BeginWrite(Shard& shard, const Key& key) {
+            Slot* slot = PrepareSlot(shard, key);
+            shard.version_.fetch_add(1, std::memory_order_acq_rel);
+            if (!slot->IsUsed()) {
+                slot->key.store(key, std::memory_order_relaxed);
+                slot->is_used.store(true, std::memory_order_relaxed);
+                ++shard.size_;
+            }
+            return slot;
         }
     };
 
-    explicit ConcurrentMap(size_t bucket_count) : vector_(bucket_count) {
+    // four shards per hardware thread keep the chance of two writers meeting low
+    ConcurrentMap() : ConcurrentMap(std::max(1u, std::thread::hardware_concurrency()) * 4) {
+    }
+
+    explicit ConcurrentMap(size_t bucket_count) : vector_(std::max<size_t>(bucket_count, 1)) {
     }
 
     Access operator[](const Key& key) {
-        auto& part = vector_[static_cast<uint32_t>(key) % vector_.size()];
-        return {key, part};
+        return {key, GetShard(key)};
+    }
+
+    // Lock-free read
+    std::optional<Value> Find(const Key& key) const {
+        const Shard& shard = GetShard(key);
+        for (;;) {
+            const uint64_t version = shard.version_.load(std::memory_order_acquire);
+            if (version % 2 == 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::optional<Value> result;
+            if (const Table* table = shard.table_.load(std::memory_order_acquire)) {
+                const Slot* slot = FindSlot(*table, key);
+                if (slot->IsUsed()) {
+                    result = slot->LoadValue();
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (shard.version_.load(std::memory_order_relaxed) == version) {
+                return result;
+            }
+        }
     }
 
     void Erase(const Key& key) {
-        auto& [mutex, map] = vector_[static_cast<uint32_t>(key) % vector_.size()];
-        std::lock_guard guard(mutex);
-        map.erase(key);
+        Shard& shard = GetShard(key);
+        std::lock_guard guard(shard.m_);
+        Table* table = shard.table_.load(std::memory_order_relaxed);
+        if (table == nullptr) {
+            return;
+        }
+        Slot* slot = FindSlot(*table, key);
+        if (!slot->IsUsed()) {
+            return;
+        }
+
+        WriteGuard write_guard(shard);
+        // backward shift deletion: entries after the hole move back if the hole lies on their probe path
+        const size_t mask = table->slots.size() - 1;
+        size_t hole = slot - table->slots.data();
+        for (size_t index = (hole + 1) & mask; table->slots[index].IsUsed(); index = (index + 1) & mask) {
+            const size_t home = Hash(table->slots[index].GetKey()) & mask;
+            if (((index - home) & mask) >= ((index - hole) & mask)) {
+                table->slots[hole].CopyFrom(table->slots[index]);
+                hole = index;
+            }
+        }
+        table->slots[hole].Clear();
+        --shard.size_;
+    }
+
+    // Calls function(key, value) for every entry, one shard locked at a time; changes of the value
+    // are stored back, also when the function throws
+    template <typename Function>
+    void ForEach(Function function) {
+        for (Shard& shard : vector_) {
+            std::lock_guard guard(shard.m_);
+            WriteGuard write_guard(shard);
+            if (Table* table = shard.table_.load(std::memory_order_relaxed)) {
+                for (Slot& slot : table->slots) {
+                    if (slot.IsUsed()) {
+                        Value value = slot.LoadValue();
+                        try {
+                            function(slot.GetKey(), value);
+                        } catch (...) {
+                            slot.StoreValue(value);
+                            throw;
+                        }
+                        slot.StoreValue(value);
+                    }
+                }
+            }
+        }
+    }
+
+    size_t Size() {
+        size_t size = 0;
+        for (Shard& shard : vector_) {
+            std::lock_guard guard(shard.m_);
+            size += shard.size_;
+        }
+        return size;
     }
 
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
-        for (auto& [mutex, map] : vector_) {
-            std::lock_guard guard(mutex);
-            result.insert(map.begin(), map.end());
-        }
+        ForEach([&result](const Key& key, const Value& value) {
+            result.emplace(key, value);
+        });
         return result;
     }
 
+private:
+    static uint64_t Hash(Key key) {
+        // splitmix64 finalizer, consecutive ids spread over all shards and slots
+        auto hash = static_cast<uint64_t>(key);
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+        return hash ^ (hash >> 31);
+    }
+
+    Shard& GetShard(const Key& key) {
+        return vector_[(Hash(key) >> 32) % vector_.size()];
+    }
+
+    const Shard& GetShard(const Key& key) const {
+        return vector_[(Hash(key) >> 32) % vector_.size()];
+    }
+
+    template <typename TableType>
+    static auto* FindSlot(TableType& table, const Key& key) {
+        const size_t mask = table.slots.size() - 1;
+        size_t index = Hash(key) & mask;
+        while (table.slots[index].IsUsed() && table.slots[index].GetKey() != key) {
+            index = (index + 1) & mask;
+        }
+        return &table.slots[index];
+    }
+
+    // Slot of the key or the free slot to put it in, growing the table if it is full.
+    // Must be called with the shard locked; readers see the new table only when it is complete.
+    static Slot* PrepareSlot(Shard& shard, const Key& key) {
+        Table* table = shard.table_.load(std::memory_order_relaxed);
+        if (table != nullptr) {
+            Slot* slot = FindSlot(*table, key);
+            if (slot->IsUsed()) {
+                return slot;
+            }
+        }
+        if (table == nullptr || (shard.size_ + 1) * 4 > table->slots.size() * 3) {
+            table = Grow(shard);
+        }
+        return FindSlot(*table, key);
+    }
+
+    static Table* Grow(Shard& shard) {
+        Table* old_table = shard.table_.load(std::memory_order_relaxed);
+        const size_t size = old_table == nullptr ? MIN_TABLE_SIZE : old_table->slots.size() * 2;
+        auto table = std::make_unique<Table>(size);
+        if (old_table != nullptr) {
+            for (const Slot& slot : old_table->slots) {
+                if (slot.IsUsed()) {
+                    FindSlot(*table, slot.GetKey())->CopyFrom(slot);
+                }
+            }
+        }
+        shard.tables_.push_back(std::move(table));
+        shard.table_.store(shard.tables_.back().get(), std::memory_order_release);
+        return shard.tables_.back().get();
+    }
 };
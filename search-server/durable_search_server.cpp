@@ -0,0 +1,311 @@
+#include "durable_search_server.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Records of the log and the snapshot are in the native byte order
+enum class RecordType : char {
+    ADD_DOCUMENT = 'A',
+    REMOVE_DOCUMENT = 'R',
+};
+
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'P', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+template <typename T>
+void AppendValue(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {
+    }
+
+    template <typename T>
+    T Read() {
+        T value;
+        std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+
+    std::string_view Take(size_t size) {
+        if (data_.size() < size) {
+            throw std::runtime_error("Unexpected end of a durable index record");
+        }
+        const std::string_view result = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return result;
+    }
+
+    std::string_view TakeRest() {
+        return Take(data_.size());
+    }
+
+    bool IsEnd() const {
+        return data_.empty();
+    }
+
+private:
+    std::string_view data_;
+};
+
+uint64_t ComputeChecksum(std::string_view data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char c : data) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void SyncPath(const std::string& path, int flags) {
+    const int file = open(path.c_str(), flags);
+    const bool synced = file >= 0 && fsync(file) == 0;
+    if (file >= 0) {
+        close(file);
+    }
+    if (!synced) {
+        throw std::runtime_error("Can't sync " + path);
+    }
+}
+
+}
+
+DurableSearchServer::DurableSearchServer(std::string_view stop_words_text, const std::string& directory,
+                                         WriteAheadLogOptions options)
+        : directory_(directory),
+          search_server_(stop_words_text) {
+    std::filesystem::create_directories(directory_);
+    const uint64_t snapshot_sequence_number = LoadSnapshot();
+    // a crash between writing a snapshot and emptying the log leaves records the snapshot holds
+    const uint64_t log_sequence_number = WriteAheadLog::Replay(
+            GetLogPath(),
+            [this, snapshot_sequence_number](uint64_t sequence_number, std::string_view record) {
+                if (sequence_number > snapshot_sequence_number) {
+                    Apply(record);
+                }
+            });
+    log_ = std::make_unique<WriteAheadLog>(GetLogPath(),
+                                           std::max(snapshot_sequence_number, log_sequence_number) + 1,
+                                           options);
+}
+
+void DurableSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    std::string record;
+    AppendValue(record, RecordType::ADD_DOCUMENT);
+    AppendValue(record, static_cast<int32_t>(document_id));
+    AppendValue(record, static_cast<int32_t>(status));
+    AppendValue(record, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        AppendValue(record, static_cast<int32_t>(rating));
+    }
+    record.append(document);
+
+    uint64_t sequence_number;
+    {
+        std::unique_lock lock(mutex_);
+        // an invalid document is rejected before it gets to the log
+        search_server_.AddDocument(document_id, document, status, ratings);
+        try {
+            sequence_number = log_->Append(record);
+        } catch (...) {
+            search_server_.RemoveDocument(document_id);
+            throw;
+        }
+    }
+    try {
+        log_->WaitDurable(sequence_number);
+    } catch (...) {
+        // the record is lost with the log, so is the document
+        std::unique_lock lock(mutex_);
+        if (search_server_.document_ordinals_.count(document_id)) {
+            removing_ids_.erase(document_id);
+            search_server_.RemoveDocument(document_id);
+        }
+        throw;
+    }
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    std::string record;
+    AppendValue(record, RecordType::REMOVE_DOCUMENT);
+    AppendValue(record, static_cast<int32_t>(document_id));
+
+    uint64_t sequence_number;
+    {
+        std::unique_lock lock(mutex_);
+        // an unknown document or one being removed is rejected before it gets to the log
+        search_server_.GetOrdinal(document_id);
+        if (removing_ids_.count(document_id)) {
+            throw std::out_of_range("No document with id " + std::to_string(document_id));
+        }
+        sequence_number = log_->Append(record);
+        removing_ids_.insert(document_id);
+    }
+    try {
+        log_->WaitDurable(sequence_number);
+    } catch (...) {
+        std::unique_lock lock(mutex_);
+        removing_ids_.erase(document_id);
+        throw;
+    }
+    // a checkpoint may have removed the document meanwhile
+    std::unique_lock lock(mutex_);
+    if (removing_ids_.erase(document_id)) {
+        search_server_.RemoveDocument(document_id);
+    }
+}
+
+void DurableSearchServer::Checkpoint() {
+    std::unique_lock lock(mutex_);
+    const uint64_t covered_sequence_number = log_->GetLastSequenceNumber();
+    SaveSnapshot(covered_sequence_number);
+    // the snapshot holds the records not written yet too, the removals among them are durable
+    for (const int document_id : removing_ids_) {
+        search_server_.RemoveDocument(document_id);
+    }
+    removing_ids_.clear();
+    // and their writers are released
+    log_->Truncate(covered_sequence_number);
+}
+
+std::vector<Document> DurableSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    std::shared_lock lock(mutex_);
+    return search_server_.FindTopDocuments(raw_query);
+}
+
+std::vector<Document> DurableSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentStatus status) const {
+    std::shared_lock lock(mutex_);
+    return search_server_.FindTopDocuments(raw_query, status);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+DurableSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    std::shared_lock lock(mutex_);
+    return search_server_.MatchDocument(raw_query, document_id);
+}
+
+int DurableSearchServer::GetDocumentCount() const {
+    std::shared_lock lock(mutex_);
+    return search_server_.GetDocumentCount();
+}
+
+uint64_t DurableSearchServer::GetCommitCount() const {
+    return log_->GetCommitCount();
+}
+
+std::string DurableSearchServer::GetSnapshotPath() const {
+    return (std::filesystem::path(directory_) / "snapshot").string();
+}
+
+std::string DurableSearchServer::GetLogPath() const {
+    return (std::filesystem::path(directory_) / "log").string();
+}
+
+uint64_t DurableSearchServer::LoadSnapshot() {
+    std::ifstream in(GetSnapshotPath(), std::ios::binary);
+    if (!in) {
+        return 0;
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Reader reader(data);
+    if (reader.Take(sizeof(SNAPSHOT_MAGIC)) != std::string_view(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))
+        || reader.Read<uint32_t>() != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Not a snapshot " + GetSnapshotPath());
+    }
+    reader.Read<uint32_t>();
+    const std::string_view body(data.data(), data.size() - sizeof(uint64_t));
+    Reader checksum_reader(std::string_view(data).substr(body.size()));
+    if (checksum_reader.Read<uint64_t>() != ComputeChecksum(body)) {
+        throw std::runtime_error("Snapshot is damaged " + GetSnapshotPath());
+    }
+
+    const auto last_sequence_number = reader.Read<uint64_t>();
+    const auto document_count = reader.Read<uint64_t>();
+    std::vector<std::pair<std::string_view, uint32_t>> word_counts;
+    for (uint64_t i = 0; i < document_count; ++i) {
+        const auto document_id = reader.Read<int32_t>();
+        const auto status = static_cast<DocumentStatus>(reader.Read<int32_t>());
+        const auto rating = reader.Read<int32_t>();
+        const auto word_count = reader.Read<uint32_t>();
+        word_counts.resize(reader.Read<uint32_t>());
+        for (auto& [word, count] : word_counts) {
+            word = reader.Take(reader.Read<uint32_t>());
+            count = reader.Read<uint32_t>();
+        }
+        search_server_.AddDocumentCounts(document_id, status, rating, word_count, word_counts);
+    }
+    return last_sequence_number;
+}
+
+void DurableSearchServer::SaveSnapshot(uint64_t last_sequence_number) const {
+    std::string data(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    AppendValue(data, SNAPSHOT_VERSION);
+    AppendValue(data, uint32_t{0});
+    AppendValue(data, last_sequence_number);
+    AppendValue(data, static_cast<uint64_t>(search_server_.document_ids_.size() - removing_ids_.size()));
+    for (const int document_id : search_server_.document_ids_) {
+        if (removing_ids_.count(document_id)) {
+            continue;
+        }
+        const uint32_t ordinal = search_server_.GetOrdinal(document_id);
+        const uint32_t word_count = search_server_.document_word_counts_[ordinal];
+        const auto& term_freqs = search_server_.document_term_freqs_[ordinal];
+        AppendValue(data, static_cast<int32_t>(document_id));
+        AppendValue(data, static_cast<int32_t>(search_server_.document_statuses_[ordinal]));
+        AppendValue(data, static_cast<int32_t>(search_server_.document_ratings_[ordinal]));
+        AppendValue(data, word_count);
+        AppendValue(data, static_cast<uint32_t>(term_freqs.size()));
+        for (const auto [term, term_freq] : term_freqs) {
+            const std::string_view word = search_server_.terms_.GetTerm(term);
+            AppendValue(data, static_cast<uint32_t>(word.size()));
+            data.append(word);
+            AppendValue(data, static_cast<uint32_t>(std::lround(term_freq * word_count)));
+        }
+    }
+    AppendValue(data, ComputeChecksum(data));
+
+    // the old snapshot is replaced only by a complete new one
+    const std::string temporary_path = GetSnapshotPath() + ".tmp";
+    {
+        std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Can't write snapshot " + temporary_path);
+        }
+    }
+    SyncPath(temporary_path, O_RDONLY);
+    std::filesystem::rename(temporary_path, GetSnapshotPath());
+    SyncPath(directory_, O_RDONLY | O_DIRECTORY);
+}
+
+void DurableSearchServer::Apply(std::string_view record) {
+    Reader reader(record);
+    const auto type = reader.Read<RecordType>();
+    const auto document_id = reader.Read<int32_t>();
+    if (type == RecordType::REMOVE_DOCUMENT) {
+        search_server_.RemoveDocument(document_id);
+        return;
+    }
+    if (type != RecordType::ADD_DOCUMENT) {
+        throw std::runtime_error("Unknown record in write-ahead log " + GetLogPath());
+    }
+    const auto status = static_cast<DocumentStatus>(reader.Read<int32_t>());
+    std::vector<int> ratings(reader.Read<uint32_t>());
+    for (int& rating : ratings) {
+        rating = reader.Read<int32_t>();
+    }
+    search_server_.AddDocument(document_id, reader.TakeRest(), status, ratings);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+// SearchServer kept in memory that survives restarts. The directory holds a snapshot of
+// the index and a write-ahead log of the changes made after it. AddDocument and
+// RemoveDocument append the change to the log and return once it is durable; concurrent
+// writers share fsyncs through the group commit of the log. If the log fails, the change
+// is not kept in the index either. Opening the directory loads the snapshot and replays
+// the log on top of it. Queries may see an added document a moment before its writer
+// is acknowledged, a removed one stays until the removal is durable.
+class DurableSearchServer {
+public:
+    DurableSearchServer(std::string_view stop_words_text, const std::string& directory,
+                        WriteAheadLogOptions options = {});
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Writes the index to a new snapshot and empties the log, so the next start replays less
+    void Checkpoint();
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    // Writes of the log, each has made a group of changes durable
+    uint64_t GetCommitCount() const;
+
+private:
+    std::string directory_;
+    mutable std::shared_mutex mutex_;
+    SearchServer search_server_;
+    std::unique_ptr<WriteAheadLog> log_;
+    // removals in the log that are not durable yet, the documents are still in the index
+    std::unordered_set<int> removing_ids_;
+
+    std::string GetSnapshotPath() const;
+    std::string GetLogPath() const;
+
+    // Returns the last sequence number the snapshot holds, 0 if there is no snapshot
+    uint64_t LoadSnapshot();
+    void SaveSnapshot(uint64_t last_sequence_number) const;
+
+    void Apply(std::string_view record);
+};
+
+
+template <typename DocumentPredicate>
+std::vector<Document> DurableSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentPredicate document_predicate) const {
+    std::shared_lock lock(mutex_);
+    return search_server_.FindTopDocuments(raw_query, document_predicate);
+}
@@ -0,0 +1,435 @@
+#include "frozen_search_server.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+// Index file: a header followed by the arrays, each starting at a multiple of 8 bytes
+enum Section {
+    TERM_CHARS,
+    TERM_OFFSETS,
+    TERM_INVERSE_DOCUMENT_FREQS,
+    POSTING_BYTES,
+    POSTING_BLOCKS,
+    POSTING_LISTS,
+    DOCUMENT_IDS,
+    DOCUMENT_INVERSE_WORD_COUNTS,
+    DOCUMENT_RATINGS,
+    DOCUMENT_STATUSES,
+    SECTION_COUNT,
+};
+
+constexpr char INDEX_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+constexpr uint32_t INDEX_VERSION = 1;
+// written in the native byte order, a file from a machine with another order won't match
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct SectionEntry {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t file_size;
+    // of everything after the header
+    uint64_t checksum;
+    SectionEntry sections[SECTION_COUNT];
+};
+
+static_assert(sizeof(IndexHeader) % 8 == 0);
+static_assert(sizeof(int) == sizeof(int32_t) && sizeof(DocumentStatus) == sizeof(int32_t));
+
+struct SectionSource {
+    const void* data;
+    size_t count;
+    size_t element_size;
+};
+
+size_t AlignUp(size_t size) {
+    return (size + 7) / 8 * 8;
+}
+
+uint64_t ComputeChecksum(const char* data, size_t size) {
+    // 8 bytes at a time with a multiply-xorshift mix
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ size;
+    size_t pos = 0;
+    for (; pos + 8 <= size; pos += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + pos, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+    for (; pos < size; ++pos) {
+        hash = (hash ^ static_cast<unsigned char>(data[pos])) * 0xc4ceb9fe1a85ec53ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+std::vector<uint64_t> WriteRegion(const SectionSource (&sections)[SECTION_COUNT]) {
+    IndexHeader header{};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    size_t size = sizeof(IndexHeader);
+    for (int section = 0; section < SECTION_COUNT; ++section) {
+        header.sections[section] = {size, sections[section].count};
+        size = AlignUp(size + sections[section].count * sections[section].element_size);
+    }
+    header.file_size = size;
+
+    std::vector<uint64_t> buffer(size / 8);
+    char* region = reinterpret_cast<char*>(buffer.data());
+    for (int section = 0; section < SECTION_COUNT; ++section) {
+        if (sections[section].count > 0) {
+            std::memcpy(region + header.sections[section].offset, sections[section].data,
+                        sections[section].count * sections[section].element_size);
+        }
+    }
+    header.checksum = ComputeChecksum(region + sizeof(IndexHeader), size - sizeof(IndexHeader));
+    std::memcpy(region, &header, sizeof(IndexHeader));
+    return buffer;
+}
+
+template <typename T>
+ArrayView<T> GetSection(ArrayView<char> region, const IndexHeader& header, Section section) {
+    const SectionEntry& entry = header.sections[section];
+    if (entry.offset % 8 != 0 || entry.offset < sizeof(IndexHeader) || entry.offset > region.size()
+        || entry.count > (region.size() - entry.offset) / sizeof(T)) {
+        throw std::runtime_error("Index file is damaged: section out of bounds");
+    }
+    return {reinterpret_cast<const T*>(region.data() + entry.offset), entry.count};
+}
+
+}
+
+FrozenSearchServer::FrozenSearchServer(const SearchServer& search_server) {
+    // frozen documents are numbered in ascending id order
+    std::vector<uint32_t> ordinal_to_document(search_server.ordinal_to_document_id_.size());
+    std::vector<int> document_ids;
+    std::vector<double> document_inverse_word_counts;
+    std::vector<int> document_ratings;
+    std::vector<DocumentStatus> document_statuses;
+    for (const int document_id : search_server.document_ids_) {
+        const uint32_t ordinal = search_server.GetOrdinal(document_id);
+        ordinal_to_document[ordinal] = static_cast<uint32_t>(document_ids.size());
+        document_ids.push_back(document_id);
+        document_inverse_word_counts.push_back(1.0 / search_server.document_word_counts_[ordinal]);
+        document_ratings.push_back(search_server.document_ratings_[ordinal]);
+        document_statuses.push_back(search_server.document_statuses_[ordinal]);
+    }
+
+    std::vector<TermId> terms;
+    for (TermId term = 0; term < search_server.term_to_document_freqs_.size(); ++term) {
+        if (!search_server.term_to_document_freqs_[term].empty()) {
+            terms.push_back(term);
+        }
+    }
+    std::sort(terms.begin(), terms.end(),
+              [&search_server](TermId lhs, TermId rhs) {
+                  return search_server.terms_.GetTerm(lhs) < search_server.terms_.GetTerm(rhs);
+              });
+
+    std::string term_chars;
+    std::vector<uint32_t> term_offsets = {0};
+    std::vector<double> term_inverse_document_freqs;
+    CompressedPostings postings;
+    std::vector<CompressedPostings::Posting> term_postings;
+    for (const TermId term : terms) {
+        const auto& document_freqs = search_server.term_to_document_freqs_[term];
+        term_chars.append(search_server.terms_.GetTerm(term));
+        term_offsets.push_back(static_cast<uint32_t>(term_chars.size()));
+        term_inverse_document_freqs.push_back(search_server.ComputeTermInverseDocumentFreq(term));
+
+        term_postings.clear();
+        for (const auto [ordinal, term_freq] : document_freqs) {
+            // term frequencies are sums of 1 / word count, so the occurrence count is recovered exactly
+            const auto count = static_cast<uint32_t>(std::lround(term_freq * search_server.document_word_counts_[ordinal]));
+            term_postings.push_back({ordinal_to_document[ordinal], count});
+        }
+        std::sort(term_postings.begin(), term_postings.end(),
+                  [](const CompressedPostings::Posting& lhs, const CompressedPostings::Posting& rhs) {
+                      return lhs.document < rhs.document;
+                  });
+        postings.AddList(term_postings);
+    }
+
+    SectionSource sections[SECTION_COUNT];
+    sections[TERM_CHARS] = {term_chars.data(), term_chars.size(), sizeof(char)};
+    sections[TERM_OFFSETS] = {term_offsets.data(), term_offsets.size(), sizeof(uint32_t)};
+    sections[TERM_INVERSE_DOCUMENT_FREQS] = {term_inverse_document_freqs.data(), term_inverse_document_freqs.size(),
+                                             sizeof(double)};
+    sections[POSTING_BYTES] = {postings.GetBytes().data(), postings.GetBytes().size(), sizeof(uint8_t)};
+    sections[POSTING_BLOCKS] = {postings.GetBlocks().data(), postings.GetBlocks().size(),
+                                sizeof(CompressedPostings::Block)};
+    sections[POSTING_LISTS] = {postings.GetListOffsets().data(), postings.GetListOffsets().size(),
+                               sizeof(CompressedPostings::ListOffset)};
+    sections[DOCUMENT_IDS] = {document_ids.data(), document_ids.size(), sizeof(int)};
+    sections[DOCUMENT_INVERSE_WORD_COUNTS] = {document_inverse_word_counts.data(), document_inverse_word_counts.size(),
+                                              sizeof(double)};
+    sections[DOCUMENT_RATINGS] = {document_ratings.data(), document_ratings.size(), sizeof(int)};
+    sections[DOCUMENT_STATUSES] = {document_statuses.data(), document_statuses.size(), sizeof(DocumentStatus)};
+    buffer_ = WriteRegion(sections);
+    Attach({reinterpret_cast<const char*>(buffer_.data()), buffer_.size() * 8}, FileCheck::HEADER);
+}
+
+void FrozenSearchServer::Save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(region_.data(), static_cast<std::streamsize>(region_.size()));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Can't write index file " + path);
+    }
+}
+
+FrozenSearchServer FrozenSearchServer::Open(const std::string& path, FileCheck check) {
+    FrozenSearchServer frozen;
+    frozen.mapped_file_ = std::make_unique<MappedFile>(path);
+    frozen.Attach({frozen.mapped_file_->GetData(), frozen.mapped_file_->GetSize()}, check);
+    return frozen;
+}
+
+void FrozenSearchServer::Attach(ArrayView<char> region, FileCheck check) {
+    IndexHeader header;
+    if (region.size() < sizeof(IndexHeader)) {
+        throw std::runtime_error("Index file is damaged: no header");
+    }
+    std::memcpy(&header, region.data(), sizeof(IndexHeader));
+    if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+        || header.byte_order_mark != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Not an index file");
+    }
+    if (header.version != INDEX_VERSION) {
+        throw std::runtime_error("Unsupported index file version " + std::to_string(header.version));
+    }
+    if (header.file_size != region.size()) {
+        throw std::runtime_error("Index file is damaged: wrong size");
+    }
+    if (check == FileCheck::FULL
+        && header.checksum != ComputeChecksum(region.data() + sizeof(IndexHeader), region.size() - sizeof(IndexHeader))) {
+        throw std::runtime_error("Index file is damaged: checksum mismatch");
+    }
+
+    term_chars_ = GetSection<char>(region, header, TERM_CHARS);
+    term_offsets_ = GetSection<uint32_t>(region, header, TERM_OFFSETS);
+    term_inverse_document_freqs_ = GetSection<double>(region, header, TERM_INVERSE_DOCUMENT_FREQS);
+    const auto posting_lists = GetSection<CompressedPostings::ListOffset>(region, header, POSTING_LISTS);
+    postings_ = CompressedPostings(GetSection<uint8_t>(region, header, POSTING_BYTES),
+                                   GetSection<CompressedPostings::Block>(region, header, POSTING_BLOCKS),
+                                   posting_lists);
+    document_ids_ = GetSection<int>(region, header, DOCUMENT_IDS);
+    document_inverse_word_counts_ = GetSection<double>(region, header, DOCUMENT_INVERSE_WORD_COUNTS);
+    document_ratings_ = GetSection<int>(region, header, DOCUMENT_RATINGS);
+    document_statuses_ = GetSection<DocumentStatus>(region, header, DOCUMENT_STATUSES);
+
+    const size_t term_count = term_inverse_document_freqs_.size();
+    const size_t document_count = document_ids_.size();
+    if (term_offsets_.size() != term_count + 1 || posting_lists.size() != term_count + 1
+        || term_offsets_[term_count] != term_chars_.size()
+        || document_inverse_word_counts_.size() != document_count
+        || document_ratings_.size() != document_count
+        || document_statuses_.size() != document_count) {
+        throw std::runtime_error("Index file is damaged: inconsistent sections");
+    }
+    // HEADER trusts the contents of the sections; POSTINGS makes sure that no term offset,
+    // skip entry or posting sends a query out of the mapping, and FULL adds the checksum above
+    if (check != FileCheck::HEADER) {
+        if (term_offsets_[0] != 0) {
+            throw std::runtime_error("Index file is damaged: wrong term offsets");
+        }
+        for (size_t term = 0; term < term_count; ++term) {
+            if (term_offsets_[term + 1] < term_offsets_[term]) {
+                throw std::runtime_error("Index file is damaged: wrong term offsets");
+            }
+        }
+        if (!postings_.IsValid(document_count)) {
+            throw std::runtime_error("Index file is damaged: wrong posting lists");
+        }
+    }
+    region_ = region;
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                                           std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query,
+                            [status](int, DocumentStatus new_status, int)
+                            { return new_status == status; });
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
+                                                           std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query,
+                            [status](int, DocumentStatus new_status, int)
+                            { return new_status == status; });
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                                           std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
+                                                           std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+int FrozenSearchServer::GetDocumentCount() const {
+    return static_cast<int>(document_ids_.size());
+}
+
+size_t FrozenSearchServer::GetPostingsByteSize() const {
+    return postings_.GetByteSize();
+}
+
+const int* FrozenSearchServer::begin() const {
+    return document_ids_.begin();
+}
+
+const int* FrozenSearchServer::end() const {
+    return document_ids_.end();
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+FrozenSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+FrozenSearchServer::MatchDocument(const std::execution::sequenced_policy&,
+                                  std::string_view raw_query, int document_id) const {
+    const uint32_t document = FindDocument(document_id);
+    const Query query = ParseQuery(raw_query);
+    const auto status = document_statuses_[document];
+
+    for (const uint32_t term : query.minus_terms) {
+        if (HasPosting(term, document)) {
+            return {std::vector<std::string_view>{}, status};
+        }
+    }
+
+    std::vector<std::string_view> matched_words;
+    for (const uint32_t term : query.plus_terms) {
+        if (HasPosting(term, document)) {
+            matched_words.push_back(GetTerm(term));
+        }
+    }
+    return {matched_words, status};
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+FrozenSearchServer::MatchDocument(const std::execution::parallel_policy& policy,
+                                  std::string_view raw_query, int document_id) const {
+    const uint32_t document = FindDocument(document_id);
+    const Query query = ParseQuery(raw_query);
+    const auto status = document_statuses_[document];
+
+    // terms are looked up on the pool; once a minus term is found, the rest of them are skipped
+    std::atomic<bool> is_excluded = false;
+    ForEachIndex(policy, 0, query.minus_terms.size(), [&](size_t i) {
+        if (!is_excluded.load(std::memory_order_relaxed) && HasPosting(query.minus_terms[i], document)) {
+            is_excluded.store(true, std::memory_order_relaxed);
+        }
+    });
+    if (is_excluded) {
+        return {std::vector<std::string_view>{}, status};
+    }
+
+    std::vector<char> has_term(query.plus_terms.size());
+    ForEachIndex(policy, 0, query.plus_terms.size(), [&](size_t i) {
+        has_term[i] = HasPosting(query.plus_terms[i], document);
+    });
+    std::vector<std::string_view> matched_words;
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        if (has_term[i]) {
+            matched_words.push_back(GetTerm(query.plus_terms[i]));
+        }
+    }
+    return {matched_words, status};
+}
+
+std::string_view FrozenSearchServer::GetTerm(uint32_t term) const {
+    return std::string_view(term_chars_.data(), term_chars_.size()).substr(term_offsets_[term],
+                                                                          term_offsets_[term + 1] - term_offsets_[term]);
+}
+
+uint32_t FrozenSearchServer::FindTerm(std::string_view word) const {
+    uint32_t first = 0;
+    uint32_t last = static_cast<uint32_t>(term_inverse_document_freqs_.size());
+    while (first < last) {
+        const uint32_t middle = first + (last - first) / 2;
+        if (GetTerm(middle) < word) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    if (first == term_inverse_document_freqs_.size() || GetTerm(first) != word) {
+        return NO_TERM;
+    }
+    return first;
+}
+
+uint32_t FrozenSearchServer::FindDocument(int document_id) const {
+    const auto it = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    if (it == document_ids_.end() || *it != document_id) {
+        throw std::out_of_range("No document with id " + std::to_string(document_id));
+    }
+    return static_cast<uint32_t>(it - document_ids_.begin());
+}
+
+bool FrozenSearchServer::HasPosting(uint32_t term, uint32_t document) const {
+    auto cursor = postings_.Open(term);
+    cursor.Advance(document);
+    return !cursor.IsEnd() && cursor.GetDocument() == document;
+}
+
+// Same validation rules as SearchServer::ParseQuery. Stop words are never indexed,
+// so they fall out together with the other words missing from the term table.
+FrozenSearchServer::Query FrozenSearchServer::ParseQuery(std::string_view text) const {
+    thread_local std::vector<std::string_view> words;
+    if (SplitIntoWordsChecked(text, words) != text.npos) {
+        throw std::invalid_argument("Query word is invalid");
+    }
+
+    Query result;
+    for (std::string_view word : words) {
+        if (word.empty()) {
+            throw std::invalid_argument("Query word is empty");
+        }
+        bool is_minus = false;
+        if (word[0] == '-') {
+            is_minus = true;
+            word = word.substr(1);
+        }
+        if (word.empty() || word[0] == '-') {
+            throw std::invalid_argument("Query word is invalid");
+        }
+
+        const uint32_t term = FindTerm(word);
+        if (term == NO_TERM) {
+            continue;
+        }
+        if (is_minus) {
+            result.minus_terms.push_back(term);
+        } else {
+            result.plus_terms.push_back(term);
+        }
+    }
+
+    for (auto* terms : {&result.plus_terms, &result.minus_terms}) {
+        std::sort(terms->begin(), terms->end());
+        terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
+    }
+    return result;
+}
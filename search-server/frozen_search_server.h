@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "array_view.h"
+#include "compressed_postings.h"
+#include "document.h"
+#include "mapped_file.h"
+#include "score_accumulator.h"
+#include "search_server.h"
+#include "thread_pool.h"
+#include "top_documents.h"
+
+// Read-only copy of a SearchServer index stored in contiguous arrays.
+// Terms are kept in one sorted table, term i owns posting list i of the compressed postings,
+// documents are addressed by their position in ascending id order.
+// A posting keeps the number of occurrences of the term, the term frequency is
+// that number divided by the word count of the document.
+// All arrays live in one region laid out as the index file written by Save,
+// so an index opened from a file is used in place, without copying.
+class FrozenSearchServer {
+    friend class SegmentedSearchServer;
+
+public:
+    explicit FrozenSearchServer(const SearchServer& search_server);
+
+    FrozenSearchServer(FrozenSearchServer&& other) noexcept = default;
+    FrozenSearchServer& operator=(FrozenSearchServer&& other) noexcept = default;
+
+    enum class FileCheck {
+        // format, version and the bounds of the sections; their contents are trusted,
+        // so opening takes the same time for any size and pages are read on first use
+        HEADER,
+        // every term offset, skip entry and posting decoded as well, so a damaged file
+        // can't make a query read out of the mapping; only the checksum is skipped
+        POSTINGS,
+        // the checksum of the whole file as well
+        FULL,
+    };
+
+    // Writes the index to a file that Open maps back; throws std::runtime_error on failure
+    void Save(const std::string& path) const;
+
+    // Maps an index file written by Save; throws std::runtime_error if the check finds it damaged.
+    // Files from untrusted sources should be opened with POSTINGS or FULL.
+    static FrozenSearchServer Open(const std::string& path, FileCheck check = FileCheck::HEADER);
+
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                           std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy& policy,
+                                           std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                           std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy& policy,
+                                           std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                           std::string_view raw_query, DocumentStatus status,
+                                           size_t result_count) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t result_count) const;
+
+    int GetDocumentCount() const;
+
+    // Bytes taken by the posting lists
+    size_t GetPostingsByteSize() const;
+
+    const int* begin() const;
+
+    const int* end() const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(const std::execution::sequenced_policy& policy,
+                  std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(const std::execution::parallel_policy& policy,
+                  std::string_view raw_query, int document_id) const;
+
+private:
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+    // documents handled by one task of the parallel scoring
+    static constexpr size_t DOCUMENTS_PER_TASK = 4096;
+
+    // the region of an index built in memory, 8-byte words keep the arrays aligned
+    std::vector<uint64_t> buffer_;
+    std::unique_ptr<MappedFile> mapped_file_;
+    ArrayView<char> region_;
+
+    ArrayView<char> term_chars_;
+    ArrayView<uint32_t> term_offsets_;
+    ArrayView<double> term_inverse_document_freqs_;
+
+    CompressedPostings postings_;
+
+    ArrayView<int> document_ids_;
+    ArrayView<double> document_inverse_word_counts_;
+    ArrayView<int> document_ratings_;
+    ArrayView<DocumentStatus> document_statuses_;
+
+    struct Query {
+        std::vector<uint32_t> plus_terms;
+        std::vector<uint32_t> minus_terms;
+    };
+
+    FrozenSearchServer() = default;
+
+    // Points the arrays into the region, checking its layout
+    void Attach(ArrayView<char> region, FileCheck check);
+
+    std::string_view GetTerm(uint32_t term) const;
+
+    uint32_t FindTerm(std::string_view word) const;
+
+    uint32_t FindDocument(int document_id) const;
+
+    bool HasPosting(uint32_t term, uint32_t document) const;
+
+    Query ParseQuery(std::string_view text) const;
+
+    template <typename DocumentPredicate>
+    void CollectDocuments(const Query& query, DocumentPredicate& document_predicate,
+                          uint32_t first_document, uint32_t last_document,
+                          TopDocuments& top) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsForQuery(const std::execution::sequenced_policy& policy,
+                                                   const Query& query, DocumentPredicate document_predicate,
+                                                   size_t result_count) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsForQuery(const std::execution::parallel_policy& policy,
+                                                   const Query& query, DocumentPredicate document_predicate,
+                                                   size_t result_count) const;
+};
+
+
+template <typename DocumentPredicate>
+std::vector<Document> FrozenSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                           DocumentPredicate document_predicate) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const ExecutionPolicy& policy,
+                                                           std::string_view raw_query,
+                                                           DocumentPredicate document_predicate) const {
+    return FindTopDocuments(policy, raw_query, document_predicate, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const ExecutionPolicy& policy,
+                                                           std::string_view raw_query, DocumentStatus status,
+                                                           size_t result_count) const {
+    return FindTopDocuments(policy, raw_query,
+                            [status](int, DocumentStatus new_status, int)
+                            { return new_status == status; },
+                            result_count);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const ExecutionPolicy& policy,
+                                                           std::string_view raw_query,
+                                                           DocumentPredicate document_predicate,
+                                                           size_t result_count) const {
+    return FindTopDocumentsForQuery(policy, ParseQuery(raw_query), document_predicate, result_count);
+}
+
+// Scores documents [first_document, last_document) only, so that disjoint ranges
+// can be processed by different threads
+template <typename DocumentPredicate>
+void FrozenSearchServer::CollectDocuments(const Query& query, DocumentPredicate& document_predicate,
+                                          uint32_t first_document, uint32_t last_document,
+                                          TopDocuments& top) const {
+    auto& accumulator = ScoreAccumulator::ForCurrentThread(first_document, last_document);
+
+    for (const uint32_t term : query.minus_terms) {
+        auto cursor = postings_.Open(term);
+        for (cursor.Advance(first_document); !cursor.IsEnd() && cursor.GetDocument() < last_document; cursor.Next()) {
+            accumulator.Exclude(cursor.GetDocument());
+        }
+    }
+
+    for (const uint32_t term : query.plus_terms) {
+        const double inverse_document_freq = term_inverse_document_freqs_[term];
+        auto cursor = postings_.Open(term);
+        for (cursor.Advance(first_document); !cursor.IsEnd() && cursor.GetDocument() < last_document; cursor.Next()) {
+            const uint32_t document = cursor.GetDocument();
+            if (!accumulator.IsExcluded(document)
+                && document_predicate(document_ids_[document],
+                                      document_statuses_[document],
+                                      document_ratings_[document])) {
+                const double term_freq = cursor.GetCount() * document_inverse_word_counts_[document];
+                accumulator.Add(document, term_freq * inverse_document_freq);
+            }
+        }
+    }
+
+    accumulator.Drain([this, &top](uint32_t document, double relevance) {
+        top.Push({document_ids_[document],
+                  relevance,
+                  document_ratings_[document]});
+    });
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> FrozenSearchServer::FindTopDocumentsForQuery(const std::execution::sequenced_policy&,
+                                                                   const Query& query,
+                                                                   DocumentPredicate document_predicate,
+                                                                   size_t result_count) const {
+    TopDocuments top(result_count);
+    CollectDocuments(query, document_predicate,
+                     0, static_cast<uint32_t>(document_ids_.size()),
+                     top);
+    return std::move(top).Extract();
+}
+
+// Every task drains its range into its own top, the tops are merged at the end
+template <typename DocumentPredicate>
+std::vector<Document> FrozenSearchServer::FindTopDocumentsForQuery(const std::execution::parallel_policy& policy,
+                                                                   const Query& query,
+                                                                   DocumentPredicate document_predicate,
+                                                                   size_t result_count) const {
+    const size_t task_count = (document_ids_.size() + DOCUMENTS_PER_TASK - 1) / DOCUMENTS_PER_TASK;
+    std::vector<TopDocuments> task_tops(task_count, TopDocuments(result_count));
+
+    ForEachIndex(policy, 0, task_count, [&](size_t task) {
+        auto predicate = document_predicate;
+        const auto first_document = static_cast<uint32_t>(task * DOCUMENTS_PER_TASK);
+        const auto last_document = static_cast<uint32_t>(
+                std::min(document_ids_.size(), (task + 1) * DOCUMENTS_PER_TASK));
+        CollectDocuments(query, predicate, first_document, last_document, task_tops[task]);
+    });
+
+    TopDocuments top(result_count);
+    for (const TopDocuments& task_top : task_tops) {
+        top.Merge(task_top);
+    }
+    return std::move(top).Extract();
+}
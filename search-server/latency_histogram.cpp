@@ -0,0 +1,77 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+size_t LatencyHistogram::GetBucket(uint64_t value) {
+    constexpr uint64_t sub_bucket_count = uint64_t(1) << SUB_BUCKET_BITS;
+    if (value < sub_bucket_count) {
+        return static_cast<size_t>(value);
+    }
+    // the highest bit gives the power of two, the next SUB_BUCKET_BITS bits the bucket in it
+    const size_t exponent = 63 - static_cast<size_t>(__builtin_clzll(value));
+    const size_t sub_bucket = static_cast<size_t>(value >> (exponent - SUB_BUCKET_BITS)) & (sub_bucket_count - 1);
+    return ((exponent - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t bucket) {
+    constexpr size_t sub_bucket_count = size_t(1) << SUB_BUCKET_BITS;
+    if (bucket < sub_bucket_count) {
+        return bucket;
+    }
+    const size_t shift = (bucket >> SUB_BUCKET_BITS) - 1;
+    const uint64_t lower = static_cast<uint64_t>(sub_bucket_count + (bucket & (sub_bucket_count - 1))) << shift;
+    return lower + ((uint64_t(1) << shift) >> 1);
+}
+
+void LatencyHistogram::Add(uint64_t value, uint64_t count) {
+    AddToBucket(GetBucket(value), count);
+}
+
+void LatencyHistogram::AddToBucket(size_t bucket, uint64_t count) {
+    counts_[bucket] += count;
+    count_ += count;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        counts_[bucket] += other.counts_[bucket];
+    }
+    count_ += other.count_;
+}
+
+void LatencyHistogram::Subtract(const LatencyHistogram& other) {
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        counts_[bucket] -= other.counts_[bucket];
+    }
+    count_ -= other.count_;
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double fraction) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const auto rank = std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count_))),
+                                           1, count_);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += counts_[bucket];
+        if (seen >= rank) {
+            return GetBucketValue(bucket);
+        }
+    }
+    return GetMax();
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    for (size_t bucket = BUCKET_COUNT; bucket > 0; --bucket) {
+        if (counts_[bucket - 1] != 0) {
+            return GetBucketValue(bucket - 1);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Counts of values in log-linear buckets, as in HDR histograms: every power of two
+// is split into 2^SUB_BUCKET_BITS equal buckets, so a percentile read from the
+// histogram is off by at most a quarter of the value, whatever its scale.
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 2;
+    static constexpr size_t BUCKET_COUNT = 64 << SUB_BUCKET_BITS;
+
+    static size_t GetBucket(uint64_t value);
+
+    // The middle of the bucket
+    static uint64_t GetBucketValue(size_t bucket);
+
+    void Add(uint64_t value, uint64_t count = 1);
+    void AddToBucket(size_t bucket, uint64_t count);
+
+    void Merge(const LatencyHistogram& other);
+    // other must be an earlier state of this histogram
+    void Subtract(const LatencyHistogram& other);
+
+    uint64_t GetCount() const;
+
+    // The value not exceeded by the given fraction of the values, 0 for an empty histogram
+    uint64_t GetPercentile(double fraction) const;
+
+    uint64_t GetMax() const;
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> counts_ = {};
+    uint64_t count_ = 0;
+};
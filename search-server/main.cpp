@@ -3,6 +3,21 @@
 #include "../tests/test_RemoveDocument.h"
 #include "../tests/test_MatchDoc.h"
 #include "../tests/test_FindTop.h"
+#include "../tests/test_Frozen.h"
+#include "../tests/test_Wand.h"
+#include "../tests/test_ConcurrentMap.h"
+#include "../tests/test_AddDocuments.h"
+#include "../tests/test_Versioned.h"
+#include "../tests/test_Segmented.h"
+#include "../tests/test_Sharded.h"
+#include "../tests/test_Durable.h"
+#include "../tests/test_ResultCache.h"
+#include "../tests/test_ThreadPool.h"
+#include "../tests/test_Async.h"
+#include "../tests/test_RequestQueue.h"
+#include "../tests/test_Metrics.h"
+#include "../tests/test_Duplicates.h"
+#include "../tests/test_NearDuplicates.h"
 
 using namespace std;
 
@@ -12,11 +27,28 @@ int main() {
     // test "test_RemoveDocument.h"
     Test_ProcessQueries();
     Test_ProcessQueriesJoined();
+    Test_ProcessQueriesFlat();
     Test_RemoveDocument();
     //
     Test_MatchDocument();
     //
     Test_FindTop();
+    //
+    Test_FrozenSearchServer();
+    Test_Wand();
+    Test_ConcurrentMap();
+    Test_AddDocuments();
+    Test_VersionedSearchServer();
+    Test_SegmentedSearchServer();
+    Test_ShardedSearchServer();
+    Test_DurableSearchServer();
+    Test_ResultCache();
+    Test_ThreadPool();
+    Test_AsyncSearchServer();
+    Test_RequestQueue();
+    Test_Metrics();
+    Test_Duplicates();
+    Test_NearDuplicates();
 
     return 0;
 }
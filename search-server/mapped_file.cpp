@@ -0,0 +1,37 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) {
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("Can't open " + path);
+    }
+    struct stat file_stat {};
+    if (fstat(file, &file_stat) != 0) {
+        close(file);
+        throw std::runtime_error("Can't read the size of " + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED) {
+            close(file);
+            throw std::runtime_error("Can't map " + path);
+        }
+        data_ = static_cast<const char*>(data);
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(file);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
@@ -0,0 +1,170 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct ThreadMetrics {
+    std::atomic<uint64_t> latencies[METRICS_STAGE_COUNT][LatencyHistogram::BUCKET_COUNT] = {};
+    std::atomic<uint64_t> counters[METRICS_COUNTER_COUNT] = {};
+};
+
+struct MetricsRegistry {
+    std::mutex mutex;
+    std::vector<const ThreadMetrics*> threads;
+    // left by finished threads
+    MetricsSnapshot retired;
+    // subtracted from every snapshot, set by Reset
+    MetricsSnapshot baseline;
+};
+
+MetricsRegistry& GetRegistry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void AddTo(MetricsSnapshot& snapshot, const ThreadMetrics& metrics) {
+    for (size_t stage = 0; stage < METRICS_STAGE_COUNT; ++stage) {
+        for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+            const uint64_t count = metrics.latencies[stage][bucket].load(std::memory_order_relaxed);
+            if (count != 0) {
+                snapshot.stages[stage].AddToBucket(bucket, count);
+            }
+        }
+    }
+    for (size_t counter = 0; counter < METRICS_COUNTER_COUNT; ++counter) {
+        snapshot.counters[counter] += metrics.counters[counter].load(std::memory_order_relaxed);
+    }
+}
+
+// Registers the metrics of a thread on its first record and retires them when it ends
+class ThreadMetricsOwner {
+public:
+    ThreadMetricsOwner() {
+        MetricsRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.threads.push_back(&metrics_);
+    }
+
+    ~ThreadMetricsOwner() {
+        MetricsRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        AddTo(registry.retired, metrics_);
+        registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &metrics_));
+    }
+
+    ThreadMetrics& Get() {
+        return metrics_;
+    }
+
+private:
+    ThreadMetrics metrics_;
+};
+
+ThreadMetrics& GetThreadMetrics() {
+    thread_local ThreadMetricsOwner owner;
+    return owner.Get();
+}
+
+// the owning thread is the only writer, a plain load and store is enough
+void Increase(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+MetricsSnapshot SumAll(MetricsRegistry& registry) {
+    MetricsSnapshot snapshot = registry.retired;
+    for (const ThreadMetrics* metrics : registry.threads) {
+        AddTo(snapshot, *metrics);
+    }
+    return snapshot;
+}
+
+}
+
+std::string_view GetMetricsStageName(MetricsStage stage) {
+    switch (stage) {
+        case MetricsStage::PARSE:
+            return "parse";
+        case MetricsStage::MINUS_FILTER:
+            return "minus_filter";
+        case MetricsStage::POSTING_SCAN:
+            return "posting_scan";
+        case MetricsStage::TOP_K:
+            return "top_k";
+        case MetricsStage::MATCH_DOCUMENT:
+            return "match_document";
+        case MetricsStage::ADD_DOCUMENT:
+            return "add_document";
+        case MetricsStage::ADD_DOCUMENTS:
+            return "add_documents";
+        case MetricsStage::REMOVE_DOCUMENT:
+            return "remove_document";
+        default:
+            return "unknown";
+    }
+}
+
+std::string_view GetMetricsCounterName(MetricsCounter counter) {
+    switch (counter) {
+        case MetricsCounter::QUERIES:
+            return "queries";
+        case MetricsCounter::MATCHES:
+            return "matches";
+        case MetricsCounter::DOCUMENTS_ADDED:
+            return "documents_added";
+        case MetricsCounter::DOCUMENTS_REMOVED:
+            return "documents_removed";
+        case MetricsCounter::POSTINGS_SCANNED:
+            return "postings_scanned";
+        default:
+            return "unknown";
+    }
+}
+
+std::ostream& operator<<(std::ostream& out, const MetricsSnapshot& snapshot) {
+    for (size_t stage = 0; stage < METRICS_STAGE_COUNT; ++stage) {
+        const LatencyHistogram& histogram = snapshot.stages[stage];
+        out << GetMetricsStageName(static_cast<MetricsStage>(stage))
+            << ": count = " << histogram.GetCount()
+            << ", p50 = " << histogram.GetPercentile(0.5) << " ns"
+            << ", p99 = " << histogram.GetPercentile(0.99) << " ns"
+            << ", p999 = " << histogram.GetPercentile(0.999) << " ns"
+            << ", max = " << histogram.GetMax() << " ns" << std::endl;
+    }
+    for (size_t counter = 0; counter < METRICS_COUNTER_COUNT; ++counter) {
+        out << GetMetricsCounterName(static_cast<MetricsCounter>(counter))
+            << ": " << snapshot.counters[counter] << std::endl;
+    }
+    return out;
+}
+
+void Metrics::Record(MetricsStage stage, std::chrono::nanoseconds duration) {
+    const auto nanoseconds = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+    Increase(GetThreadMetrics().latencies[static_cast<size_t>(stage)][LatencyHistogram::GetBucket(nanoseconds)], 1);
+}
+
+void Metrics::AddEnabled(MetricsCounter counter, uint64_t value) {
+    Increase(GetThreadMetrics().counters[static_cast<size_t>(counter)], value);
+}
+
+MetricsSnapshot Metrics::GetSnapshot() {
+    MetricsRegistry& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    MetricsSnapshot snapshot = SumAll(registry);
+    for (size_t stage = 0; stage < METRICS_STAGE_COUNT; ++stage) {
+        snapshot.stages[stage].Subtract(registry.baseline.stages[stage]);
+    }
+    for (size_t counter = 0; counter < METRICS_COUNTER_COUNT; ++counter) {
+        snapshot.counters[counter] -= registry.baseline.counters[counter];
+    }
+    return snapshot;
+}
+
+void Metrics::Reset() {
+    // the threads' histograms are never cleared, only their current sum is remembered
+    MetricsRegistry& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    registry.baseline = SumAll(registry);
+}
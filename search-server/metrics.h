@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+#include "latency_histogram.h"
+#include "log_duration.h"
+
+// Stages of the search server timed when metrics are on
+enum class MetricsStage {
+    PARSE,
+    MINUS_FILTER,
+    POSTING_SCAN,
+    TOP_K,
+    MATCH_DOCUMENT,
+    ADD_DOCUMENT,
+    // a whole AddDocuments batch
+    ADD_DOCUMENTS,
+    REMOVE_DOCUMENT,
+    COUNT,
+};
+
+enum class MetricsCounter {
+    QUERIES,
+    MATCHES,
+    DOCUMENTS_ADDED,
+    DOCUMENTS_REMOVED,
+    // posting entries the searches read, to compare the exhaustive search with WAND
+    POSTINGS_SCANNED,
+    COUNT,
+};
+
+constexpr size_t METRICS_STAGE_COUNT = static_cast<size_t>(MetricsStage::COUNT);
+constexpr size_t METRICS_COUNTER_COUNT = static_cast<size_t>(MetricsCounter::COUNT);
+
+std::string_view GetMetricsStageName(MetricsStage stage);
+std::string_view GetMetricsCounterName(MetricsCounter counter);
+
+// Durations are in nanoseconds
+struct MetricsSnapshot {
+    std::array<LatencyHistogram, METRICS_STAGE_COUNT> stages;
+    std::array<uint64_t, METRICS_COUNTER_COUNT> counters = {};
+
+    const LatencyHistogram& operator[](MetricsStage stage) const {
+        return stages[static_cast<size_t>(stage)];
+    }
+
+    uint64_t operator[](MetricsCounter counter) const {
+        return counters[static_cast<size_t>(counter)];
+    }
+};
+
+// One line per stage with its count and percentiles, then the counters
+std::ostream& operator<<(std::ostream& out, const MetricsSnapshot& snapshot);
+
+// Process-wide stage timings and counters. Every thread writes to its own histograms,
+// which only it changes, so recording takes neither locks nor contended atomics;
+// a snapshot sums the histograms of all threads, those of finished threads included.
+// Metrics are off by default and then cost a relaxed load per stage.
+class Metrics {
+public:
+    static void SetEnabled(bool enabled) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    static bool IsEnabled() {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    static void Record(MetricsStage stage, std::chrono::nanoseconds duration);
+
+    static void Add(MetricsCounter counter, uint64_t value = 1) {
+        if (IsEnabled()) {
+            AddEnabled(counter, value);
+        }
+    }
+
+    // What was recorded since the start or the last Reset
+    static MetricsSnapshot GetSnapshot();
+
+    static void Reset();
+
+private:
+    inline static std::atomic<bool> enabled_{false};
+
+    static void AddEnabled(MetricsCounter counter, uint64_t value);
+};
+
+// Stage durations of the tasks of one parallel operation, summed and recorded once per stage
+// by the thread that owns it when it goes out of scope; a parallel query then counts once
+// per stage like a sequential one, with the time the stage took all of its threads
+class StageTotals {
+public:
+    StageTotals()
+            : enabled_(Metrics::IsEnabled()) {
+    }
+
+    StageTotals(const StageTotals&) = delete;
+    StageTotals& operator=(const StageTotals&) = delete;
+
+    ~StageTotals() {
+        if (!enabled_) {
+            return;
+        }
+        const uint32_t added = added_.load(std::memory_order_relaxed);
+        for (size_t stage = 0; stage < METRICS_STAGE_COUNT; ++stage) {
+            if (added & (1u << stage)) {
+                Metrics::Record(static_cast<MetricsStage>(stage),
+                                std::chrono::nanoseconds(totals_[stage].load(std::memory_order_relaxed)));
+            }
+        }
+    }
+
+    bool IsEnabled() const {
+        return enabled_;
+    }
+
+    void Add(MetricsStage stage, std::chrono::nanoseconds duration) {
+        const auto index = static_cast<size_t>(stage);
+        totals_[index].fetch_add(duration.count(), std::memory_order_relaxed);
+        added_.fetch_or(1u << index, std::memory_order_relaxed);
+    }
+
+private:
+    bool enabled_;
+    std::array<std::atomic<int64_t>, METRICS_STAGE_COUNT> totals_ = {};
+    std::atomic<uint32_t> added_{0};
+};
+
+// Records the time from its construction to its destruction, like LogDuration;
+// with totals, adds it to them instead
+class StageDuration {
+public:
+    using Clock = LogDuration::Clock;
+
+    explicit StageDuration(MetricsStage stage, StageTotals* totals = nullptr)
+            : stage_(stage)
+            , totals_(totals)
+            , enabled_(totals ? totals->IsEnabled() : Metrics::IsEnabled()) {
+        if (enabled_) {
+            start_time_ = Clock::now();
+        }
+    }
+
+    StageDuration(const StageDuration&) = delete;
+    StageDuration& operator=(const StageDuration&) = delete;
+
+    ~StageDuration() {
+        if (!enabled_) {
+            return;
+        }
+        const auto duration = Clock::now() - start_time_;
+        if (totals_) {
+            totals_->Add(stage_, duration);
+        } else {
+            Metrics::Record(stage_, duration);
+        }
+    }
+
+private:
+    MetricsStage stage_;
+    StageTotals* totals_;
+    bool enabled_;
+    Clock::time_point start_time_;
+};
+
+#define STAGE_DURATION(x) StageDuration UNIQUE_VAR_NAME_PROFILE(x)
+#define STAGE_DURATION_INTO(x, totals) StageDuration UNIQUE_VAR_NAME_PROFILE(x, totals)
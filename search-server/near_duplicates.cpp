@@ -0,0 +1,223 @@
+#include "near_duplicates.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+#include "thread_pool.h"
+
+namespace {
+
+uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+// Union-find over ordinals with path halving and union by size
+class DisjointSets {
+public:
+    explicit DisjointSets(size_t size)
+            : parents_(size)
+            , sizes_(size, 1) {
+        std::iota(parents_.begin(), parents_.end(), 0);
+    }
+
+    uint32_t Find(uint32_t element) {
+        while (parents_[element] != element) {
+            parents_[element] = parents_[parents_[element]];
+            element = parents_[element];
+        }
+        return element;
+    }
+
+    void Unite(uint32_t lhs, uint32_t rhs) {
+        lhs = Find(lhs);
+        rhs = Find(rhs);
+        if (lhs == rhs) {
+            return;
+        }
+        if (sizes_[lhs] < sizes_[rhs]) {
+            std::swap(lhs, rhs);
+        }
+        parents_[rhs] = lhs;
+        sizes_[lhs] += sizes_[rhs];
+    }
+
+private:
+    std::vector<uint32_t> parents_;
+    std::vector<uint32_t> sizes_;
+};
+
+}
+
+NearDuplicateFinder::NearDuplicateFinder(NearDuplicateOptions options)
+        : options_(options) {
+    if (!(options_.jaccard_threshold >= 0.0 && options_.jaccard_threshold <= 1.0)) {
+        throw std::invalid_argument("Jaccard threshold is out of [0, 1]");
+    }
+    if (options_.band_count == 0 || options_.rows_per_band == 0) {
+        throw std::invalid_argument("Signature is empty");
+    }
+    seeds_.resize(options_.band_count * options_.rows_per_band);
+    uint64_t state = options_.seed;
+    for (uint64_t& seed : seeds_) {
+        state += 0x9e3779b97f4a7c15ULL;
+        seed = Mix(state);
+    }
+}
+
+std::vector<std::vector<int>> NearDuplicateFinder::FindClusters(const SearchServer& search_server) const {
+    return FindClusters(std::execution::seq, search_server);
+}
+
+std::vector<std::vector<int>> NearDuplicateFinder::FindClusters(const std::execution::sequenced_policy& policy,
+                                                                const SearchServer& search_server) const {
+    return FindClustersIn(policy, search_server);
+}
+
+std::vector<std::vector<int>> NearDuplicateFinder::FindClusters(const std::execution::parallel_policy& policy,
+                                                                const SearchServer& search_server) const {
+    return FindClustersIn(policy, search_server);
+}
+
+double NearDuplicateFinder::ComputeSimilarity(const SearchServer& search_server,
+                                              int lhs_document_id, int rhs_document_id) {
+    return ComputeSimilarity(search_server,
+                             search_server.GetOrdinal(lhs_document_id), search_server.GetOrdinal(rhs_document_id));
+}
+
+template <typename ExecutionPolicy>
+std::vector<std::vector<int>> NearDuplicateFinder::FindClustersIn(const ExecutionPolicy& policy,
+                                                                  const SearchServer& search_server) const {
+    const auto ordinal_count = static_cast<uint32_t>(search_server.ordinal_to_document_id_.size());
+    std::vector<uint32_t> ordinals;
+    for (uint32_t ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+        if (search_server.ordinal_to_document_id_[ordinal] != SearchServer::INVALID_DOCUMENT_ID) {
+            ordinals.push_back(ordinal);
+        }
+    }
+
+    // min-hashes of document i are signatures[i * signature_size ...], the higher halves
+    // of the hashes are enough to tell the minima apart
+    const size_t signature_size = seeds_.size();
+    std::vector<uint32_t> signatures(ordinals.size() * signature_size);
+    ForEachIndex(policy, 0, ordinals.size(), [&](size_t i) {
+        const auto signature = signatures.begin() + i * signature_size;
+        std::fill(signature, signature + signature_size, std::numeric_limits<uint32_t>::max());
+        for (const auto& [term, term_freq] : search_server.document_term_freqs_[ordinals[i]]) {
+            const uint64_t term_hash = SearchServer::GetTermFingerprint(term);
+            for (size_t row = 0; row < signature_size; ++row) {
+                const auto hash = static_cast<uint32_t>(Mix(term_hash ^ seeds_[row]) >> 32);
+                signature[row] = std::min(signature[row], hash);
+            }
+        }
+    });
+
+    // every band sorts the documents by the hash of its rows, equal hashes make a bucket
+    struct BandEntry {
+        uint64_t key;
+        uint32_t document;
+    };
+    std::vector<std::vector<BandEntry>> bands(options_.band_count);
+    ForEachIndex(policy, 0, options_.band_count, [&](size_t band) {
+        std::vector<BandEntry>& entries = bands[band];
+        entries.reserve(ordinals.size());
+        for (size_t i = 0; i < ordinals.size(); ++i) {
+            uint64_t key = seeds_[band];
+            for (size_t row = band * options_.rows_per_band; row < (band + 1) * options_.rows_per_band; ++row) {
+                key = Mix(key ^ signatures[i * signature_size + row]);
+            }
+            entries.push_back({key, static_cast<uint32_t>(i)});
+        }
+        std::sort(entries.begin(), entries.end(), [](const BandEntry& lhs, const BandEntry& rhs) {
+            return std::tie(lhs.key, lhs.document) < std::tie(rhs.key, rhs.document);
+        });
+    });
+
+    // the documents of a bucket are kept grouped by cluster; a new one is compared with the members
+    // of every other cluster until one is similar, then joined to it. Every similar pair of the
+    // bucket is still found, while a bucket of copies costs a comparison per entry.
+    DisjointSets clusters(ordinals.size());
+    std::vector<std::vector<uint32_t>> bucket_clusters;
+    for (const std::vector<BandEntry>& entries : bands) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (i == 0 || entries[i].key != entries[i - 1].key) {
+                bucket_clusters.clear();
+            }
+            const uint32_t document = entries[i].document;
+            for (const std::vector<uint32_t>& members : bucket_clusters) {
+                if (clusters.Find(members.front()) == clusters.Find(document)) {
+                    continue;
+                }
+                for (const uint32_t member : members) {
+                    if (ComputeSimilarity(search_server, ordinals[member], ordinals[document])
+                        >= options_.jaccard_threshold) {
+                        clusters.Unite(member, document);
+                        break;
+                    }
+                }
+            }
+
+            // the clusters the document joined become one with it
+            const uint32_t root = clusters.Find(document);
+            std::vector<uint32_t>* joined = nullptr;
+            for (auto it = bucket_clusters.begin(); it != bucket_clusters.end();) {
+                if (clusters.Find(it->front()) != root) {
+                    ++it;
+                } else if (joined == nullptr) {
+                    joined = &*it;
+                    ++it;
+                } else {
+                    joined->insert(joined->end(), it->begin(), it->end());
+                    it = bucket_clusters.erase(it);
+                }
+            }
+            if (joined != nullptr) {
+                joined->push_back(document);
+            } else {
+                bucket_clusters.push_back({document});
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> clustered(ordinals.size());
+    for (uint32_t i = 0; i < ordinals.size(); ++i) {
+        clustered[clusters.Find(i)].push_back(search_server.ordinal_to_document_id_[ordinals[i]]);
+    }
+    std::vector<std::vector<int>> result;
+    for (std::vector<int>& cluster : clustered) {
+        if (cluster.size() > 1) {
+            std::sort(cluster.begin(), cluster.end());
+            result.push_back(std::move(cluster));
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+double NearDuplicateFinder::ComputeSimilarity(const SearchServer& search_server, uint32_t lhs, uint32_t rhs) {
+    const auto& lhs_terms = search_server.document_term_freqs_[lhs];
+    const auto& rhs_terms = search_server.document_term_freqs_[rhs];
+    if (lhs_terms.empty() && rhs_terms.empty()) {
+        return 1.0;
+    }
+    // both maps are ordered by term, so the intersection is counted in one merge
+    size_t common = 0;
+    auto lhs_it = lhs_terms.begin();
+    auto rhs_it = rhs_terms.begin();
+    while (lhs_it != lhs_terms.end() && rhs_it != rhs_terms.end()) {
+        if (lhs_it->first < rhs_it->first) {
+            ++lhs_it;
+        } else if (rhs_it->first < lhs_it->first) {
+            ++rhs_it;
+        } else {
+            ++common;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return static_cast<double>(common) / static_cast<double>(lhs_terms.size() + rhs_terms.size() - common);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <vector>
+
+#include "search_server.h"
+
+struct NearDuplicateOptions {
+    // documents with at least this Jaccard similarity of their sets of words are clustered
+    double jaccard_threshold = 0.8;
+    // A signature holds band_count * rows_per_band min-hashes. Two documents become
+    // candidates when all rows of some band match, which for similarity s happens with
+    // probability 1 - (1 - s^rows_per_band)^band_count: 99.9% at 0.8 and 5% at 0.3 by default.
+    size_t band_count = 20;
+    size_t rows_per_band = 5;
+    uint64_t seed = 0;
+};
+
+// Finds clusters of documents with nearly the same words in one pass over the index.
+// Every document gets a MinHash signature of its set of words, stop words aside;
+// documents sharing a band of the signature fall into one LSH bucket, and only pairs
+// from a bucket have their exact Jaccard similarity computed. Pairs at the threshold or
+// above are joined into clusters, so a cluster is a chain of similar documents.
+class NearDuplicateFinder {
+public:
+    explicit NearDuplicateFinder(NearDuplicateOptions options = {});
+
+    // Clusters of two or more document ids, ids and clusters ascending.
+    // The parallel version computes signatures and buckets of different bands simultaneously.
+    std::vector<std::vector<int>> FindClusters(const SearchServer& search_server) const;
+    std::vector<std::vector<int>> FindClusters(const std::execution::sequenced_policy& policy,
+                                               const SearchServer& search_server) const;
+    std::vector<std::vector<int>> FindClusters(const std::execution::parallel_policy& policy,
+                                               const SearchServer& search_server) const;
+
+    // Exact Jaccard similarity of the sets of words of two documents
+    static double ComputeSimilarity(const SearchServer& search_server, int lhs_document_id, int rhs_document_id);
+
+private:
+    NearDuplicateOptions options_;
+    // seeds of the hash functions, one per row of the signature
+    std::vector<uint64_t> seeds_;
+
+    template <typename ExecutionPolicy>
+    std::vector<std::vector<int>> FindClustersIn(const ExecutionPolicy& policy,
+                                                 const SearchServer& search_server) const;
+
+    static double ComputeSimilarity(const SearchServer& search_server, uint32_t lhs, uint32_t rhs);
+};
@@ -10,11 +10,9 @@ std::vector<std::vector<Document>> ProcessQueries(
         const std::vector<std::string>& queries) {
     std::vector<std::vector<Document>> documents_lists(queries.size());
 
-    std::transform(std::execution::par,
-                   queries.begin(), queries.end(),
-                   documents_lists.begin(),
-                   [&search_server](const std::string& query){
-                    return search_server.FindTopDocuments(query); });
+    ForEachIndex(std::execution::par, 0, queries.size(), [&](size_t i) {
+        documents_lists[i] = search_server.FindTopDocuments(queries[i]);
+    });
 
     return documents_lists;
 }
@@ -22,12 +20,46 @@ std::vector<std::vector<Document>> ProcessQueries(
 std::vector<Document> ProcessQueriesJoined(
         const SearchServer& search_server,
         const std::vector<std::string>& queries) {
-    std::vector<Document> joined;
+    return std::move(ProcessQueriesFlat(search_server, queries).documents);
+}
+
+QueryResults ProcessQueriesFlat(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries) {
+    QueryResults results;
+    ProcessQueriesFlat(search_server, queries, 0, queries.size(), results);
+    return results;
+}
 
-    for (const auto& documents : ProcessQueries(search_server, queries)) {
-        std::transform(documents.begin(), documents.end(),
-                       std::back_inserter(joined),
-                       [](const auto& x) {return x;});
+void ProcessQueriesFlat(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries,
+        size_t first, size_t last,
+        QueryResults& results) {
+    if (first > last || last > queries.size()) {
+        throw std::invalid_argument("Query range [" + std::to_string(first) + ", " + std::to_string(last)
+                                    + ") is out of " + std::to_string(queries.size()) + " queries");
+    }
+    const size_t query_count = last - first;
+    // every query gets room for a full top, offsets[i + 1] keeps the size of query i for now
+    results.documents.resize(query_count * MAX_RESULT_DOCUMENT_COUNT);
+    results.offsets.assign(query_count + 1, 0);
+    ForEachIndex(std::execution::par, 0, query_count, [&](size_t query) {
+        const auto documents = search_server.FindTopDocuments(queries[first + query]);
+        std::copy(documents.begin(), documents.end(),
+                  results.documents.begin() + query * MAX_RESULT_DOCUMENT_COUNT);
+        results.offsets[query + 1] = documents.size();
+    });
+
+    // tops shorter than the maximum leave gaps, which are closed moving documents forward
+    size_t size = 0;
+    for (size_t query = 0; query < query_count; ++query) {
+        const size_t found = results.offsets[query + 1];
+        const auto slot = results.documents.begin() + query * MAX_RESULT_DOCUMENT_COUNT;
+        std::move(slot, slot + found, results.documents.begin() + size);
+        results.offsets[query] = size;
+        size += found;
     }
-    return joined;
-}
\ No newline at end of file
+    results.offsets[query_count] = size;
+    results.documents.resize(size);
+}
@@ -6,7 +6,24 @@
 #include <algorithm>
 #include <execution>
 
+#include "array_view.h"
 #include "search_server.h"
+#include "thread_pool.h"
+
+// Results of a batch of queries in one buffer:
+// the documents of query i are documents[offsets[i]] .. documents[offsets[i + 1]]
+struct QueryResults {
+    std::vector<Document> documents;
+    std::vector<size_t> offsets;
+
+    size_t GetQueryCount() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    ArrayView<Document> operator[](size_t query) const {
+        return {documents.data() + offsets[query], offsets[query + 1] - offsets[query]};
+    }
+};
 
 std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
@@ -15,3 +32,35 @@ std::vector<std::vector<Document>> ProcessQueries(
 std::vector<Document> ProcessQueriesJoined(
         const SearchServer& search_server,
         const std::vector<std::string>& queries);
+
+QueryResults ProcessQueriesFlat(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries);
+
+// Answers queries [first, last) into results, reusing their buffers;
+// throws std::invalid_argument if the range is not within queries
+void ProcessQueriesFlat(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries,
+        size_t first, size_t last,
+        QueryResults& results);
+
+// Calls sink(query_index, document) for every found document in query order.
+// Queries are answered in windows of QUERIES_PER_WINDOW, only one window of results is kept.
+template <typename Sink>
+void ProcessQueriesStreamed(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries,
+        Sink sink) {
+    static constexpr size_t QUERIES_PER_WINDOW = 16 * 1024;
+    QueryResults window;
+    for (size_t first = 0; first < queries.size(); first += QUERIES_PER_WINDOW) {
+        const size_t last = std::min(queries.size(), first + QUERIES_PER_WINDOW);
+        ProcessQueriesFlat(search_server, queries, first, last, window);
+        for (size_t query = 0; query < last - first; ++query) {
+            for (const Document& document : window[query]) {
+                sink(first + query, document);
+            }
+        }
+    }
+}
@@ -4,41 +4,119 @@
 
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server) :
-        search_server_(const_cast<SearchServer &>(search_server)),
-        current_time_(0),
-        no_results_request_(0)
+#include <algorithm>
+#include <thread>
+
+RequestQueue::RequestQueue(const SearchServer& search_server, std::chrono::seconds window) :
+        search_server_(search_server),
+        window_(std::max(window, std::chrono::seconds(1))),
+        // лишняя корзина, чтобы запись в новую секунду не стирала ещё видимую
+        bucket_count_(static_cast<size_t>(window_.count()) + 1),
+        buckets_(std::make_unique<SecondBucket[]>(bucket_count_))
 {
-    // напишите реализацию
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    // напишите реализацию
-    const auto top_documents = search_server_.FindTopDocuments(raw_query, status);
-    AddRequests(top_documents.size());
-    return top_documents;
+    return Track([&] {
+        return search_server_.FindTopDocuments(raw_query, status);
+    });
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-    // напишите реализацию
-    const auto top_documents = search_server_.FindTopDocuments(raw_query);
-    AddRequests(top_documents.size());
-    return top_documents;
+    return Track([&] {
+        return search_server_.FindTopDocuments(raw_query);
+    });
+}
+
+void RequestQueue::Record(Clock::time_point time, Clock::duration latency, size_t result_count) {
+    SecondBucket* bucket = ClaimBucket(ToSecond(time));
+    if (bucket == nullptr) {
+        return;
+    }
+    bucket->requests.fetch_add(1, std::memory_order_relaxed);
+    if (result_count == 0) {
+        bucket->no_result_requests.fetch_add(1, std::memory_order_relaxed);
+    }
+    const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    bucket->latencies[LatencyHistogram::GetBucket(std::max<int64_t>(microseconds, 0))].fetch_add(1, std::memory_order_relaxed);
+    bucket->writers.fetch_sub(1, std::memory_order_release);
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    // напишите реализацию
-    return no_results_request_;
+    return static_cast<int>(GetStats().no_result_requests);
+}
+
+RequestStats RequestQueue::GetStats() const {
+    return GetStats(Clock::now());
+}
+
+RequestStats RequestQueue::GetStats(Clock::time_point now) const {
+    const uint64_t last_second = ToSecond(now);
+    const uint64_t window = static_cast<uint64_t>(window_.count());
+
+    RequestStats stats;
+    LatencyHistogram latencies;
+    for (size_t i = 0; i < bucket_count_; ++i) {
+        const SecondBucket& bucket = buckets_[i];
+        const uint64_t second = bucket.second.load(std::memory_order_acquire);
+        if ((second & RESETTING) != 0 || second > last_second || second + window <= last_second) {
+            continue;
+        }
+        stats.requests += bucket.requests.load(std::memory_order_relaxed);
+        stats.no_result_requests += bucket.no_result_requests.load(std::memory_order_relaxed);
+        for (size_t j = 0; j < LatencyHistogram::BUCKET_COUNT; ++j) {
+            latencies.AddToBucket(j, bucket.latencies[j].load(std::memory_order_relaxed));
+        }
+    }
+    if (stats.requests == 0) {
+        return stats;
+    }
+
+    stats.queries_per_second = static_cast<double>(stats.requests) / static_cast<double>(window);
+    stats.no_result_rate = static_cast<double>(stats.no_result_requests) / static_cast<double>(stats.requests);
+    stats.p50 = std::chrono::microseconds(latencies.GetPercentile(0.5));
+    stats.p99 = std::chrono::microseconds(latencies.GetPercentile(0.99));
+    stats.p999 = std::chrono::microseconds(latencies.GetPercentile(0.999));
+    return stats;
 }
 
-void RequestQueue::AddRequests(int top_doc_num) {
-    ++current_time_;
-    //удаление устаревших результаов
-    for (;!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp;
-          requests_.pop_front()){
-        if(requests_.front().results == 0) --no_results_request_;
+RequestQueue::SecondBucket* RequestQueue::ClaimBucket(uint64_t second) {
+    SecondBucket& bucket = buckets_[second % bucket_count_];
+    for (;;) {
+        uint64_t current = bucket.second.load(std::memory_order_acquire);
+        if (current == second) {
+            // писатель объявляется и перепроверяет метку: либо он увидит обнуление,
+            // либо обнуляющий дождётся его записи
+            bucket.writers.fetch_add(1, std::memory_order_seq_cst);
+            if (bucket.second.load(std::memory_order_seq_cst) == second) {
+                return &bucket;
+            }
+            bucket.writers.fetch_sub(1, std::memory_order_release);
+            continue;
+        }
+        if ((current & RESETTING) != 0) {
+            // другой поток обнуляет корзину, это считанные наносекунды
+            std::this_thread::yield();
+            continue;
+        }
+        if (current > second) {
+            // корзину уже заняла более поздняя секунда, запись вне окна
+            return nullptr;
+        }
+        if (bucket.second.compare_exchange_weak(current, second | RESETTING, std::memory_order_seq_cst)) {
+            while (bucket.writers.load(std::memory_order_seq_cst) != 0) {
+                std::this_thread::yield();
+            }
+            bucket.requests.store(0, std::memory_order_relaxed);
+            bucket.no_result_requests.store(0, std::memory_order_relaxed);
+            for (auto& latency : bucket.latencies) {
+                latency.store(0, std::memory_order_relaxed);
+            }
+            bucket.second.store(second, std::memory_order_release);
+        }
     }
-    //раз есть теперь место можно запушить
-    requests_.push_back({current_time_, top_doc_num});
-    if(top_doc_num == 0) ++no_results_request_;
-}
\ No newline at end of file
+}
+
+uint64_t RequestQueue::ToSecond(Clock::time_point time) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count());
+}
@@ -3,13 +3,36 @@
 //
 #pragma once
 
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
+#include "latency_histogram.h"
 #include "search_server.h"
 
+struct RequestStats {
+    uint64_t requests = 0;
+    uint64_t no_result_requests = 0;
+    double queries_per_second = 0.0;
+    double no_result_rate = 0.0;
+    std::chrono::microseconds p50{0};
+    std::chrono::microseconds p99{0};
+    std::chrono::microseconds p999{0};
+};
+
+// Статистика запросов за последние window секунд по steady_clock.
+// Каждая секунда - корзина в кольце: счётчики и гистограмма задержек на атомиках,
+// так что запросы можно записывать из любого числа потоков без общей блокировки.
+// Корзину, на которую пришла новая секунда, обнуляет тот поток, что первым её застолбил,
+// дождавшись писателей прошлой секунды.
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestQueue(const SearchServer& search_server, std::chrono::seconds window = std::chrono::seconds(60));
 
     // сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
     template <typename DocumentPredicate>
@@ -19,27 +42,52 @@ public:
 
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
+    // Для запросов, выполненных в обход очереди; слишком старые, вне окна, отбрасываются
+    void Record(Clock::time_point time, Clock::duration latency, size_t result_count);
+
     int GetNoResultRequests() const;
 
+    RequestStats GetStats() const;
+    RequestStats GetStats(Clock::time_point now) const;
+
 private:
-    struct QueryResult {
-        // определите, что должно быть в структуре
-        uint64_t timestamp;
-        int results;
+    // старший бит метки: корзину сейчас обнуляют
+    static constexpr uint64_t RESETTING = uint64_t(1) << 63;
+
+    struct SecondBucket {
+        std::atomic<uint64_t> second{0};
+        // потоки, пишущие в корзину прямо сейчас
+        std::atomic<uint32_t> writers{0};
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> no_result_requests{0};
+        std::atomic<uint32_t> latencies[LatencyHistogram::BUCKET_COUNT] = {};
     };
-    std::deque<QueryResult> requests_;
-    const static int min_in_day_ = 1440;
-    SearchServer& search_server_;
-    uint64_t current_time_;
-    int no_results_request_;
 
-    void AddRequests(int top_doc_num);
+    const SearchServer& search_server_;
+    std::chrono::seconds window_;
+    size_t bucket_count_;
+    std::unique_ptr<SecondBucket[]> buckets_;
+
+    template <typename Search>
+    std::vector<Document> Track(Search search);
+
+    SecondBucket* ClaimBucket(uint64_t second);
+
+    static uint64_t ToSecond(Clock::time_point time);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    // напишите реализацию
-    const auto top_documents = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequests(top_documents.size());
+    return Track([&] {
+        return search_server_.FindTopDocuments(raw_query, document_predicate);
+    });
+}
+
+template <typename Search>
+std::vector<Document> RequestQueue::Track(Search search) {
+    const auto start = Clock::now();
+    auto top_documents = search();
+    const auto finish = Clock::now();
+    Record(finish, finish - start, top_documents.size());
     return top_documents;
-}
\ No newline at end of file
+}
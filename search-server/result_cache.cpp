@@ -0,0 +1,139 @@
+#include "result_cache.h"
+
+#include <algorithm>
+
+ResultCache::ResultCache(size_t capacity)
+        : capacity_(capacity),
+          shard_count_(std::clamp<size_t>(capacity, 1, SHARD_COUNT)) {
+}
+
+ResultCache::ResultCache(const ResultCache& other) : ResultCache(other.capacity_) {
+}
+
+ResultCache& ResultCache::operator=(const ResultCache& other) {
+    if (this != &other) {
+        capacity_ = other.capacity_;
+        shard_count_ = other.shard_count_;
+        for (Shard& shard : shards_) {
+            std::lock_guard guard(shard.mutex);
+            shard.slots.clear();
+            shard.entries.clear();
+            shard.hand = 0;
+        }
+        hits_ = 0;
+        misses_ = 0;
+    }
+    return *this;
+}
+
+size_t ResultCache::GetCapacity() const {
+    return capacity_;
+}
+
+size_t ResultCache::GetSize() const {
+    size_t size = 0;
+    for (Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+std::optional<std::vector<Document>> ResultCache::Find(const std::vector<TermId>& plus_terms,
+                                                       const std::vector<TermId>& minus_terms,
+                                                       DocumentStatus status, size_t result_count,
+                                                       uint64_t generation) const {
+    if (capacity_ == 0) {
+        return std::nullopt;
+    }
+    const Key key = MakeKey(plus_terms, minus_terms, status, result_count);
+    Shard& shard = GetShard(key);
+    {
+        std::lock_guard guard(shard.mutex);
+        const auto it = shard.slots.find(key);
+        if (it != shard.slots.end() && shard.entries[it->second].generation == generation) {
+            Entry& entry = shard.entries[it->second];
+            entry.referenced = true;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return entry.documents;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+void ResultCache::Insert(const std::vector<TermId>& plus_terms, const std::vector<TermId>& minus_terms,
+                         DocumentStatus status, size_t result_count, uint64_t generation,
+                         const std::vector<Document>& documents) const {
+    if (capacity_ == 0) {
+        return;
+    }
+    Key key = MakeKey(plus_terms, minus_terms, status, result_count);
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+
+    const auto it = shard.slots.find(key);
+    if (it != shard.slots.end()) {
+        Entry& entry = shard.entries[it->second];
+        entry.generation = generation;
+        entry.documents = documents;
+        return;
+    }
+    if (shard.entries.size() < GetShardCapacity(shard)) {
+        shard.slots.emplace(key, shard.entries.size());
+        shard.entries.push_back({std::move(key), generation, documents, false});
+        return;
+    }
+
+    // entries of an older index are never read again and go first
+    for (;;) {
+        Entry& entry = shard.entries[shard.hand];
+        if (entry.referenced && entry.generation == generation) {
+            entry.referenced = false;
+            shard.hand = (shard.hand + 1) % shard.entries.size();
+            continue;
+        }
+        shard.slots.erase(entry.key);
+        shard.slots.emplace(key, shard.hand);
+        entry = {std::move(key), generation, documents, false};
+        shard.hand = (shard.hand + 1) % shard.entries.size();
+        return;
+    }
+}
+
+ResultCache::Stats ResultCache::GetStats() const {
+    return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed)};
+}
+
+ResultCache::Shard& ResultCache::GetShard(const Key& key) const {
+    return shards_[(KeyHash()(key) >> 32) % shard_count_];
+}
+
+size_t ResultCache::GetShardCapacity(const Shard& shard) const {
+    const auto index = static_cast<size_t>(&shard - shards_.data());
+    return capacity_ / shard_count_ + (index < capacity_ % shard_count_ ? 1 : 0);
+}
+
+ResultCache::Key ResultCache::MakeKey(const std::vector<TermId>& plus_terms, const std::vector<TermId>& minus_terms,
+                                      DocumentStatus status, size_t result_count) {
+    Key key{{}, static_cast<uint32_t>(plus_terms.size()), status, result_count};
+    key.terms.reserve(plus_terms.size() + minus_terms.size());
+    key.terms.insert(key.terms.end(), plus_terms.begin(), plus_terms.end());
+    key.terms.insert(key.terms.end(), minus_terms.begin(), minus_terms.end());
+    return key;
+}
+
+bool ResultCache::Key::operator==(const Key& other) const {
+    return plus_term_count == other.plus_term_count && status == other.status
+           && result_count == other.result_count && terms == other.terms;
+}
+
+size_t ResultCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = (static_cast<uint64_t>(key.plus_term_count) << 40)
+                    ^ (static_cast<uint64_t>(key.status) << 32) ^ key.result_count;
+    for (const TermId term : key.terms) {
+        hash = (hash ^ term) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 29;
+    }
+    return static_cast<size_t>(hash * 0xff51afd7ed558ccdULL);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "term_dictionary.h"
+
+// Results of recent searches keyed by the parsed query (sorted unique plus and minus terms),
+// the status filter and the number of results. Every entry remembers the generation of the
+// index it was computed on; after a change of the index the old entries simply stop matching.
+// The cache is split into shards with a lock each, every shard evicts with the CLOCK
+// algorithm: an entry read since the hand last passed it gets one more round.
+// The capacity is divided between the shards exactly, a small cache uses fewer of them.
+// A copy of the cache is empty and has the same capacity, the entries belong to one index.
+class ResultCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    explicit ResultCache(size_t capacity = 0);
+
+    ResultCache(const ResultCache& other);
+    ResultCache& operator=(const ResultCache& other);
+
+    size_t GetCapacity() const;
+
+    // Number of entries held, never more than the capacity
+    size_t GetSize() const;
+
+    std::optional<std::vector<Document>> Find(const std::vector<TermId>& plus_terms,
+                                              const std::vector<TermId>& minus_terms,
+                                              DocumentStatus status, size_t result_count,
+                                              uint64_t generation) const;
+
+    void Insert(const std::vector<TermId>& plus_terms, const std::vector<TermId>& minus_terms,
+                DocumentStatus status, size_t result_count, uint64_t generation,
+                const std::vector<Document>& documents) const;
+
+    Stats GetStats() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Key {
+        // plus terms followed by minus terms
+        std::vector<TermId> terms;
+        uint32_t plus_term_count;
+        DocumentStatus status;
+        size_t result_count;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Key key;
+        uint64_t generation;
+        std::vector<Document> documents;
+        bool referenced;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<Key, size_t, KeyHash> slots;
+        std::vector<Entry> entries;
+        size_t hand = 0;
+    };
+
+    size_t capacity_;
+    // shards in use, each holds capacity_ / shard_count_ entries and the first
+    // capacity_ % shard_count_ of them one more
+    size_t shard_count_;
+    mutable std::array<Shard, SHARD_COUNT> shards_;
+    mutable std::atomic<uint64_t> hits_{0};
+    mutable std::atomic<uint64_t> misses_{0};
+
+    Shard& GetShard(const Key& key) const;
+
+    size_t GetShardCapacity(const Shard& shard) const;
+
+    static Key MakeKey(const std::vector<TermId>& plus_terms, const std::vector<TermId>& minus_terms,
+                       DocumentStatus status, size_t result_count);
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Relevance sums of documents [first_document, last_document) in a flat array indexed by
+// document ordinal. Touched ordinals are remembered, so Drain resets only what a query
+// has written and the arrays are reused by the next query of the same thread.
+class ScoreAccumulator {
+public:
+    // Scratch accumulator of the calling thread; it must be drained before the next call
+    static ScoreAccumulator& ForCurrentThread(uint32_t first_document, uint32_t last_document) {
+        thread_local ScoreAccumulator accumulator;
+        accumulator.Reset(first_document, last_document);
+        return accumulator;
+    }
+
+    // the document is dropped from the results whatever is added to it
+    void Exclude(uint32_t document) {
+        char& state = states_[document - first_document_];
+        if (state == UNSEEN) {
+            touched_.push_back(document);
+        }
+        state = EXCLUDED;
+    }
+
+    bool IsExcluded(uint32_t document) const {
+        return states_[document - first_document_] == EXCLUDED;
+    }
+
+    void Add(uint32_t document, double relevance) {
+        const uint32_t index = document - first_document_;
+        if (states_[index] == UNSEEN) {
+            states_[index] = MATCHED;
+            touched_.push_back(document);
+        }
+        if (states_[index] == MATCHED) {
+            relevances_[index] += relevance;
+        }
+    }
+
+    // Calls function(document, relevance) for every matched document and clears the accumulator
+    template <typename Function>
+    void Drain(Function function) {
+        for (const uint32_t document : touched_) {
+            const uint32_t index = document - first_document_;
+            if (states_[index] == MATCHED) {
+                function(document, relevances_[index]);
+            }
+            states_[index] = UNSEEN;
+            relevances_[index] = 0.0;
+        }
+        touched_.clear();
+    }
+
+private:
+    enum State : char {
+        UNSEEN,
+        MATCHED,
+        EXCLUDED,
+    };
+
+    uint32_t first_document_ = 0;
+    std::vector<double> relevances_;
+    std::vector<char> states_;
+    std::vector<uint32_t> touched_;
+
+    void Reset(uint32_t first_document, uint32_t last_document) {
+        // leftovers of a query interrupted by an exception
+        Drain([](uint32_t, double) {});
+        first_document_ = first_document;
+        if (relevances_.size() < last_document - first_document) {
+            relevances_.resize(last_document - first_document);
+            states_.resize(last_document - first_document, UNSEEN);
+        }
+    }
+};
@@ -4,6 +4,30 @@
 
 #include "search_server.h"
 
+namespace {
+
+std::string_view GetWordAt(std::string_view text, size_t position) {
+    const size_t word_begin = text.rfind(' ', position) + 1;
+    return text.substr(word_begin, text.find(' ', position) - word_begin);
+}
+
+}
+
+// Documents [first, last) of a batch tokenized against a dictionary of their own,
+// so that parts are built without touching the index
+struct SearchServer::BatchPart {
+    TermDictionary terms;
+    std::vector<bool> is_stop_term;
+    // (part term, occurrence count) of every document, stop words left out
+    std::vector<std::vector<std::pair<TermId, uint32_t>>> document_term_counts;
+    std::vector<uint32_t> document_word_counts;
+    // documents of the part with every part term
+    std::vector<uint32_t> term_document_counts;
+    // the first document with a control character, if any
+    size_t invalid_document = std::numeric_limits<size_t>::max();
+    std::string invalid_word;
+};
+
 
 SearchServer::SearchServer(const std::string& stop_words_text)
         : SearchServer(std::string_view(stop_words_text)) {
@@ -17,54 +41,279 @@ void SearchServer::AddDocument(int document_id,
                                std::string_view document,
                                DocumentStatus status,
                                const std::vector<int>& ratings) {
-    if (document_id < 0 || documents_.count(document_id)) {
+    STAGE_DURATION(MetricsStage::ADD_DOCUMENT);
+    if (document_id < 0 || document_ordinals_.count(document_id)) {
         throw std::invalid_argument("id is less zero or id is present, ID: " + std::to_string(document_id));
     }
 
-    const int computed_rating = ComputeAverageRating(ratings);
-    documents_.emplace(document_id,
-                       DocumentData{computed_rating,
-                                    status,
-                                    std::string (document)});
+    const std::vector<TermId> terms = SplitIntoTermsNoStop(document);
+    ResizeTermArrays();
 
-    const std::vector<std::string_view> words = SplitIntoWordsNoStop(documents_[document_id].document);
+    const uint32_t ordinal = AllocateOrdinal(document_id);
+    document_ratings_[ordinal] = ComputeAverageRating(ratings);
+    document_statuses_[ordinal] = status;
+    document_word_counts_[ordinal] = static_cast<uint32_t>(terms.size());
 
-    const double inv_word_count = 1.0 / static_cast<double>(words.size());
+    const double inv_word_count = 1.0 / static_cast<double>(terms.size());
 
-    for (std::string_view word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_id_to_word_freqs_[document_id][word] += inv_word_count;
+    auto& term_freqs = document_term_freqs_[ordinal];
+    for (const TermId term : terms) {
+        term_freqs[term] += inv_word_count;
+    }
+    uint64_t fingerprint = 0;
+    for (const auto [term, term_freq] : term_freqs) {
+        AddTermFreq(term, ordinal, term_freq);
+        fingerprint += GetTermFingerprint(term);
     }
+    document_fingerprints_[ordinal] = fingerprint;
+    IndexFingerprint(ordinal);
+    UpdateDocumentCount();
+    Metrics::Add(MetricsCounter::DOCUMENTS_ADDED);
+}
 
-    document_ids_.insert(document_id);
+void SearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::sequenced_policy& policy,
+                                const std::vector<DocumentToAdd>& documents) {
+    AddBatch(policy, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::parallel_policy& policy,
+                                const std::vector<DocumentToAdd>& documents) {
+    AddBatch(policy, documents);
+}
+
+SearchServer::BatchPart SearchServer::TokenizeBatchPart(const std::vector<DocumentToAdd>& documents,
+                                                        size_t first, size_t last) const {
+    BatchPart part;
+    part.document_term_counts.resize(last - first);
+    part.document_word_counts.resize(last - first);
+    std::vector<std::string_view> words;
+    std::vector<TermId> terms;
+    // occurrences in the current document by part term, zeroed again after every document
+    std::vector<uint32_t> occurrence_counts;
+    std::vector<TermId> first_terms;
+    for (size_t i = first; i < last; ++i) {
+        const std::string_view text = documents[i].text;
+        const size_t control_position = SplitIntoWordsChecked(text, words);
+        if (control_position != text.npos) {
+            part.invalid_document = i;
+            part.invalid_word = GetWordAt(text, control_position);
+            return part;
+        }
+
+        terms.clear();
+        for (const std::string_view word : words) {
+            const TermId term = part.terms.Intern(word);
+            if (term == part.is_stop_term.size()) {
+                // the index is only read while the parts are built
+                part.is_stop_term.push_back(IsStopTerm(terms_.Find(word)));
+            }
+            if (!part.is_stop_term[term]) {
+                terms.push_back(term);
+            }
+        }
+        part.document_word_counts[i - first] = static_cast<uint32_t>(terms.size());
+
+        // counted by part term; the first occurrences keep their order, so that terms are later
+        // interned as by AddDocument
+        first_terms.clear();
+        for (const TermId term : terms) {
+            if (term >= occurrence_counts.size()) {
+                occurrence_counts.resize(term + 1);
+            }
+            if (occurrence_counts[term]++ == 0) {
+                first_terms.push_back(term);
+            }
+        }
+        if (part.term_document_counts.size() < occurrence_counts.size()) {
+            part.term_document_counts.resize(occurrence_counts.size());
+        }
+        auto& term_counts = part.document_term_counts[i - first];
+        term_counts.reserve(first_terms.size());
+        for (const TermId term : first_terms) {
+            term_counts.emplace_back(term, occurrence_counts[term]);
+            ++part.term_document_counts[term];
+            occurrence_counts[term] = 0;
+        }
+    }
+    return part;
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::AddBatch(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents) {
+    STAGE_DURATION(MetricsStage::ADD_DOCUMENTS);
+    std::unordered_set<int> batch_ids;
+    for (const DocumentToAdd& document : documents) {
+        if (document.id < 0 || document_ordinals_.count(document.id) || !batch_ids.insert(document.id).second) {
+            throw std::invalid_argument("id is less zero or id is present, ID: " + std::to_string(document.id));
+        }
+    }
+
+    const size_t task_count = std::clamp<size_t>(documents.size() / MIN_DOCUMENTS_PER_BATCH_TASK,
+                                                 1, ThreadPool::GetDefault().GetThreadCount() * 4);
+    std::vector<BatchPart> parts(task_count);
+    ForEachIndex(policy, 0, task_count, [&](size_t task) {
+        parts[task] = TokenizeBatchPart(documents,
+                                        documents.size() * task / task_count,
+                                        documents.size() * (task + 1) / task_count);
+    });
+    for (const BatchPart& part : parts) {
+        if (part.invalid_document != std::numeric_limits<size_t>::max()) {
+            throw std::invalid_argument("Word is invalid: " + part.invalid_word);
+        }
+    }
+
+    // nothing below throws on bad input, the index is changed from here on
+    std::vector<std::vector<TermId>> part_to_term(task_count);
+    for (size_t task = 0; task < task_count; ++task) {
+        const TermDictionary& part_terms = parts[task].terms;
+        part_to_term[task].resize(part_terms.GetTermCount());
+        for (TermId term = 0; term < part_terms.GetTermCount(); ++term) {
+            part_to_term[task][term] = terms_.Intern(part_terms.GetTerm(term));
+        }
+    }
+    ResizeTermArrays();
+
+    std::vector<std::vector<uint32_t>> part_ordinals(task_count);
+    for (size_t task = 0; task < task_count; ++task) {
+        const BatchPart& part = parts[task];
+        const size_t first = documents.size() * task / task_count;
+        for (size_t index = 0; index < part.document_term_counts.size(); ++index) {
+            const DocumentToAdd& document = documents[first + index];
+            const uint32_t ordinal = AllocateOrdinal(document.id);
+            document_ratings_[ordinal] = ComputeAverageRating(document.ratings);
+            document_statuses_[ordinal] = document.status;
+            document_word_counts_[ordinal] = part.document_word_counts[index];
+            part_ordinals[task].push_back(ordinal);
+        }
+    }
+    UpdateDocumentCount();
+    Metrics::Add(MetricsCounter::DOCUMENTS_ADDED, documents.size());
+
+    // postings are laid out grouped by term: every part writes its postings of a term
+    // to its own range of the group, so the parts fill them in parallel
+    std::vector<TermId> batch_terms;
+    for (const std::vector<TermId>& terms : part_to_term) {
+        batch_terms.insert(batch_terms.end(), terms.begin(), terms.end());
+    }
+    std::sort(batch_terms.begin(), batch_terms.end());
+    batch_terms.erase(std::unique(batch_terms.begin(), batch_terms.end()), batch_terms.end());
+    std::vector<size_t> group_offsets(batch_terms.size() + 1);
+    std::vector<std::vector<size_t>> part_offsets(task_count);
+    for (size_t task = 0; task < task_count; ++task) {
+        const BatchPart& part = parts[task];
+        part_offsets[task].resize(part_to_term[task].size());
+        for (TermId part_term = 0; part_term < part.term_document_counts.size(); ++part_term) {
+            const auto group = std::lower_bound(batch_terms.begin(), batch_terms.end(), part_to_term[task][part_term])
+                               - batch_terms.begin();
+            // the range of the part starts after the ones of the parts before, shifted into place below
+            part_offsets[task][part_term] = group_offsets[group + 1];
+            group_offsets[group + 1] += part.term_document_counts[part_term];
+        }
+    }
+    std::partial_sum(group_offsets.begin(), group_offsets.end(), group_offsets.begin());
+    for (size_t task = 0; task < task_count; ++task) {
+        for (TermId part_term = 0; part_term < parts[task].term_document_counts.size(); ++part_term) {
+            const auto group = std::lower_bound(batch_terms.begin(), batch_terms.end(), part_to_term[task][part_term])
+                               - batch_terms.begin();
+            part_offsets[task][part_term] += group_offsets[group];
+        }
+    }
+
+    struct BatchPosting {
+        uint32_t ordinal;
+        double term_freq;
+    };
+    std::vector<BatchPosting> postings(group_offsets.back());
+    ForEachIndex(policy, 0, task_count, [&](size_t task) {
+        const BatchPart& part = parts[task];
+        std::vector<size_t>& offsets = part_offsets[task];
+        for (size_t index = 0; index < part.document_term_counts.size(); ++index) {
+            const uint32_t ordinal = part_ordinals[task][index];
+            const double inv_word_count = 1.0 / static_cast<double>(part.document_word_counts[index]);
+            auto& term_freqs = document_term_freqs_[ordinal];
+            for (const auto& [part_term, count] : part.document_term_counts[index]) {
+                const double term_freq = count * inv_word_count;
+                term_freqs.emplace(part_to_term[task][part_term], term_freq);
+                postings[offsets[part_term]++] = {ordinal, term_freq};
+            }
+            uint64_t fingerprint = 0;
+            for (const auto& [term, term_freq] : term_freqs) {
+                fingerprint += GetTermFingerprint(term);
+            }
+            document_fingerprints_[ordinal] = fingerprint;
+        }
+    });
+    for (const std::vector<uint32_t>& ordinals : part_ordinals) {
+        for (const uint32_t ordinal : ordinals) {
+            IndexFingerprint(ordinal);
+        }
+    }
+
+    // every group is merged into its own posting map; stop words of the batch have empty ones
+    ForEachIndex(policy, 0, batch_terms.size(), [&](size_t group) {
+        const auto first = postings.begin() + group_offsets[group];
+        const auto last = postings.begin() + group_offsets[group + 1];
+        if (first == last) {
+            return;
+        }
+        std::sort(first, last, [](const BatchPosting& lhs, const BatchPosting& rhs) {
+            return lhs.ordinal < rhs.ordinal;
+        });
+        const TermId term = batch_terms[group];
+        auto& document_freqs = term_to_document_freqs_[term];
+        TermStats& stats = term_stats_[term];
+        for (auto it = first; it != last; ++it) {
+            // ordinals ascend within a group, new ones mostly land at the end
+            document_freqs.emplace_hint(document_freqs.end(), it->ordinal, it->term_freq);
+            if (it->term_freq > stats.max_term_freq) {
+                stats.max_term_freq = it->term_freq;
+                stats.max_term_freq_count = 0;
+            }
+            if (it->term_freq == stats.max_term_freq) {
+                ++stats.max_term_freq_count;
+            }
+            RaiseBlockMax(term, it->ordinal, it->term_freq);
+        }
+        stats.log_document_freq = std::log(static_cast<double>(document_freqs.size()));
+    });
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
                                                      std::string_view raw_query, DocumentStatus status) const {
-    return SearchServer::FindTopDocuments(std::execution::seq, raw_query,
-                                          [status](int document_id, DocumentStatus new_status,  int rating)
-                                          { return new_status == status; });
+    return FindTopDocumentsWithStatus(policy, raw_query, status, MAX_RESULT_DOCUMENT_COUNT);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
                                                      std::string_view raw_query, DocumentStatus status) const {
-    return SearchServer::FindTopDocuments(std::execution::par, raw_query,
-                                          [status](int document_id, DocumentStatus new_status,  int rating)
-                                          { return new_status == status; });
+    return FindTopDocumentsWithStatus(policy, raw_query, status, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                                     std::string_view raw_query, DocumentStatus status,
+                                                     size_t result_count) const {
+    return FindTopDocumentsWithStatus(policy, raw_query, status, result_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
+                                                     std::string_view raw_query, DocumentStatus status,
+                                                     size_t result_count) const {
+    return FindTopDocumentsWithStatus(policy, raw_query, status, result_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return SearchServer::FindTopDocuments(raw_query,
-                                          [status](int document_id, DocumentStatus new_status,  int rating)
-                                          { return new_status == status; });
+    return SearchServer::FindTopDocuments(std::execution::seq, raw_query, status);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy&,
                                                      std::string_view raw_query) const {
     return SearchServer::FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy&,
                                                      std::string_view raw_query) const {
     return SearchServer::FindTopDocuments(std::execution::par, raw_query, DocumentStatus::ACTUAL);
 }
@@ -73,8 +322,153 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
     return SearchServer::FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindTopDocuments(const WandPolicy& policy,
+                                                     std::string_view raw_query, DocumentStatus status,
+                                                     size_t result_count) const {
+    // WAND finds the same documents as the exhaustive search, so they share the cached results
+    return FindTopDocumentsWithStatus(policy, raw_query, status, result_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const WandPolicy& policy,
+                                                     std::string_view raw_query, DocumentStatus status) const {
+    return SearchServer::FindTopDocuments(policy, raw_query, status, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const WandPolicy& policy,
+                                                     std::string_view raw_query) const {
+    return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+void SearchServer::SetResultCacheCapacity(size_t capacity) {
+    result_cache_ = ResultCache(capacity);
+}
+
+ResultCache::Stats SearchServer::GetResultCacheStats() const {
+    return result_cache_.GetStats();
+}
+
+std::optional<int> SearchServer::FindDuplicate(int document_id) const {
+    const uint32_t ordinal = GetOrdinal(document_id);
+    std::optional<int> duplicate;
+    const auto [first, last] = fingerprint_ordinals_.equal_range(document_fingerprints_[ordinal]);
+    for (auto it = first; it != last; ++it) {
+        const int other_id = ordinal_to_document_id_[it->second];
+        if (it->second != ordinal && (!duplicate || other_id < *duplicate) && HaveSameTerms(ordinal, it->second)) {
+            duplicate = other_id;
+        }
+    }
+    return duplicate;
+}
+
+std::optional<int> SearchServer::FindDuplicate(std::string_view document) const {
+    thread_local std::vector<std::string_view> words;
+    const size_t control_position = SplitIntoWordsChecked(document, words);
+    if (control_position != document.npos) {
+        throw std::invalid_argument("Word is invalid: " + std::string(GetWordAt(document, control_position)));
+    }
+
+    std::vector<TermId> terms;
+    terms.reserve(words.size());
+    for (const std::string_view word : words) {
+        const TermId term = terms_.Find(word);
+        if (term == TermDictionary::NO_TERM) {
+            // no document has this word
+            return std::nullopt;
+        }
+        if (!IsStopTerm(term)) {
+            terms.push_back(term);
+        }
+    }
+    SortUniq(std::execution::seq, terms);
+    uint64_t fingerprint = 0;
+    for (const TermId term : terms) {
+        fingerprint += GetTermFingerprint(term);
+    }
+
+    std::optional<int> duplicate;
+    const auto [first, last] = fingerprint_ordinals_.equal_range(fingerprint);
+    for (auto it = first; it != last; ++it) {
+        const auto& document_terms = document_term_freqs_[it->second];
+        const int other_id = ordinal_to_document_id_[it->second];
+        if ((!duplicate || other_id < *duplicate)
+            && document_terms.size() == terms.size()
+            && std::equal(terms.begin(), terms.end(), document_terms.begin(),
+                          [](TermId term, const auto& document_term) {
+                              return term == document_term.first;
+                          })) {
+            duplicate = other_id;
+        }
+    }
+    return duplicate;
+}
+
+std::vector<int> SearchServer::FindDuplicates() const {
+    return FindDuplicates(std::execution::seq);
+}
+
+std::vector<int> SearchServer::FindDuplicates(const std::execution::sequenced_policy& policy) const {
+    return FindDuplicatesIn(policy);
+}
+
+std::vector<int> SearchServer::FindDuplicates(const std::execution::parallel_policy& policy) const {
+    return FindDuplicatesIn(policy);
+}
+
+template <typename ExecutionPolicy>
+std::vector<int> SearchServer::FindDuplicatesIn(const ExecutionPolicy& policy) const {
+    // equal fingerprints share a bucket, so every task groups its own range of buckets
+    const size_t bucket_count = fingerprint_ordinals_.bucket_count();
+    const size_t task_count = std::clamp<size_t>(bucket_count / MIN_BUCKETS_PER_TASK,
+                                                 1, ThreadPool::GetDefault().GetThreadCount() * 4);
+    std::vector<std::vector<int>> task_duplicates(task_count);
+    ForEachIndex(policy, 0, task_count, [&](size_t task) {
+        struct Entry {
+            uint64_t fingerprint;
+            int document_id;
+            uint32_t ordinal;
+        };
+        std::vector<Entry> entries;
+        std::vector<uint32_t> originals;
+        const size_t last_bucket = bucket_count * (task + 1) / task_count;
+        for (size_t bucket = bucket_count * task / task_count; bucket < last_bucket; ++bucket) {
+            if (fingerprint_ordinals_.bucket_size(bucket) < 2) {
+                continue;
+            }
+            entries.clear();
+            for (auto it = fingerprint_ordinals_.begin(bucket); it != fingerprint_ordinals_.end(bucket); ++it) {
+                entries.push_back({it->first, ordinal_to_document_id_[it->second], it->second});
+            }
+            std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+                return std::tie(lhs.fingerprint, lhs.document_id) < std::tie(rhs.fingerprint, rhs.document_id);
+            });
+            // within a fingerprint, a document either repeats an earlier original or is one itself
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (i == 0 || entries[i].fingerprint != entries[i - 1].fingerprint) {
+                    originals.clear();
+                }
+                const bool is_duplicate = std::any_of(originals.begin(), originals.end(),
+                                                      [this, &entry = entries[i]](uint32_t original) {
+                                                          return HaveSameTerms(original, entry.ordinal);
+                                                      });
+                if (is_duplicate) {
+                    task_duplicates[task].push_back(entries[i].document_id);
+                } else {
+                    originals.push_back(entries[i].ordinal);
+                }
+            }
+        }
+    });
+
+    std::vector<int> duplicates;
+    for (const auto& part : task_duplicates) {
+        duplicates.insert(duplicates.end(), part.begin(), part.end());
+    }
+    std::sort(duplicates.begin(), duplicates.end());
+    return duplicates;
+}
+
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return static_cast<int>(document_ordinals_.size());
 }
 
 std::set<int>::const_iterator SearchServer::begin() const {
@@ -92,37 +486,30 @@ SearchServer::MatchDocument(const std::string_view raw_query, int document_id) c
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus>
-SearchServer::MatchDocument(const std::execution::sequenced_policy& policy,
+SearchServer::MatchDocument(const std::execution::sequenced_policy&,
                             const std::string_view raw_query, int document_id) const {
-    if (documents_.count(document_id) == 0) {
-        throw std::out_of_range("No document with id ");
-    }
+    STAGE_DURATION(MetricsStage::MATCH_DOCUMENT);
+    Metrics::Add(MetricsCounter::MATCHES);
+    const uint32_t ordinal = GetOrdinal(document_id);
 
     const auto query = ParseQuery(std::execution::seq, raw_query);
 
-    const auto status = documents_.at(document_id).status;
+    const auto status = document_statuses_[ordinal];
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
+    for (const TermId term : query.minus_terms) {
+        if (term_to_document_freqs_[term].count(ordinal)) {
             std::vector<std::string_view> tmp = {};
             return { tmp, status };
         }
     }
 
     std::vector<std::string_view> matched_words;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            auto it = word_to_document_freqs_.find(word);
-            if (it->first == word)
-                matched_words.push_back(it->first);
+    for (const TermId term : query.plus_terms) {
+        if (term_to_document_freqs_[term].count(ordinal)) {
+            matched_words.push_back(terms_.GetTerm(term));
         }
     }
+    std::sort(matched_words.begin(), matched_words.end());
     return { matched_words, status };
 
 }
@@ -130,38 +517,49 @@ SearchServer::MatchDocument(const std::execution::sequenced_policy& policy,
 std::tuple<std::vector<std::string_view>, DocumentStatus>
 SearchServer::MatchDocument(const std::execution::parallel_policy& policy,
                             const std::string_view raw_query, int document_id) const {
-
-    if (documents_.count(document_id) == 0) {
-        throw std::out_of_range("No document with id ");
-    }
+    STAGE_DURATION(MetricsStage::MATCH_DOCUMENT);
+    Metrics::Add(MetricsCounter::MATCHES);
+    const uint32_t ordinal = GetOrdinal(document_id);
 
     const auto query = ParseQuery(std::execution::par, raw_query);
 
-    const auto status = documents_.at(document_id).status;
+    const auto status = document_statuses_[ordinal];
 
-    const auto word_checker =
-            [this, document_id](std::string_view word) {
-                const auto it = word_to_document_freqs_.find(word);
-                return it != word_to_document_freqs_.end() && it->second.count(document_id);
+    const auto term_checker =
+            [this, ordinal](TermId term) {
+                return term_to_document_freqs_[term].count(ordinal) > 0;
             };
 
-    if (std::any_of(std::execution::par,
-                    query.minus_words.begin(),
-                    query.minus_words.end(),
-                    word_checker)) {
+    // terms are looked up on the pool; once a minus term is found, the rest of them are skipped
+    std::atomic<bool> is_excluded = false;
+    ForEachIndex(policy, 0, query.minus_terms.size(), [&](size_t i) {
+        if (!is_excluded.load(std::memory_order_relaxed) && term_checker(query.minus_terms[i])) {
+            is_excluded.store(true, std::memory_order_relaxed);
+        }
+    });
+    if (is_excluded) {
         std::vector<std::string_view> tmp = {};
         return { tmp, status };
     }
 
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    auto words_end = std::copy_if(std::execution::par,
-                                            query.plus_words.begin(), query.plus_words.end(),
-                                            matched_words.begin(),
-                                            word_checker
-                                            );
-    std::sort(std::execution::par, matched_words.begin(), words_end);
-    words_end = std::unique(std::execution::par, matched_words.begin(), words_end);
-    matched_words.erase(words_end, matched_words.end());
+    std::vector<char> has_term(query.plus_terms.size());
+    ForEachIndex(policy, 0, query.plus_terms.size(), [&](size_t i) {
+        has_term[i] = term_checker(query.plus_terms[i]);
+    });
+    std::vector<TermId> matched_terms;
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        if (has_term[i]) {
+            matched_terms.push_back(query.plus_terms[i]);
+        }
+    }
+    std::sort(matched_terms.begin(), matched_terms.end());
+    const auto terms_end = std::unique(matched_terms.begin(), matched_terms.end());
+
+    std::vector<std::string_view> matched_words(terms_end - matched_terms.begin());
+    std::transform(matched_terms.begin(), terms_end,
+                   matched_words.begin(),
+                   [this](TermId term) { return terms_.GetTerm(term); });
+    std::sort(matched_words.begin(), matched_words.end());
 
     return { matched_words, status };
 }
@@ -171,10 +569,13 @@ const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int d
     if (!words_frequencies.empty()){
         words_frequencies.clear();
     }
-    if (document_id < 0 || !documents_.count(document_id)) {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
         return words_frequencies;
     }
-    words_frequencies = document_id_to_word_freqs_.at(document_id);
+    for (const auto [term, term_freq] : document_term_freqs_[it->second]) {
+        words_frequencies.emplace(terms_.GetTerm(term), term_freq);
+    }
     return words_frequencies;
 }
 
@@ -183,51 +584,198 @@ void SearchServer::RemoveDocument(int document_id) {
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy& policy, int document_id) {
-    const std::map<std::string_view , double>& words_freqs(document_id_to_word_freqs_.at(document_id));
-    if(!words_freqs.empty()) {
-        std::vector<std::string_view> words{words_freqs.size()};
-
-        transform(policy,
-                  words_freqs.begin(), words_freqs.end(),
-                  words.begin(),
-                  [](const auto& wf){
-                      return wf.first;
+    STAGE_DURATION(MetricsStage::REMOVE_DOCUMENT);
+    const uint32_t ordinal = GetOrdinal(document_id);
+    const std::map<TermId, double>& terms_freqs(document_term_freqs_[ordinal]);
+
+    std::for_each(policy,
+                  terms_freqs.begin(), terms_freqs.end(),
+                  [this, ordinal](const auto& term_freq){
+                      RemovePosting(term_freq.first, ordinal, term_freq.second);
                   });
 
-        std::for_each(policy,
-                      words.begin(), words.end(),
-                      [this, document_id](std::string_view item){
-                          word_to_document_freqs_[item].erase(document_id);
-                      });
+    ReleaseOrdinal(document_id, ordinal);
+    UpdateDocumentCount();
+    Metrics::Add(MetricsCounter::DOCUMENTS_REMOVED);
+}
+
+void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) {
+    STAGE_DURATION(MetricsStage::REMOVE_DOCUMENT);
+    const uint32_t ordinal = GetOrdinal(document_id);
+    const std::map<TermId, double>& terms_freqs(document_term_freqs_[ordinal]);
+    const std::vector<std::pair<TermId, double>> terms(terms_freqs.begin(), terms_freqs.end());
+
+    // every term has its own posting map and stats, so the erasures don't touch shared state
+    ForEachIndex(policy, 0, terms.size(), [this, ordinal, &terms](size_t i) {
+        RemovePosting(terms[i].first, ordinal, terms[i].second);
+    });
+
+    ReleaseOrdinal(document_id, ordinal);
+    UpdateDocumentCount();
+    Metrics::Add(MetricsCounter::DOCUMENTS_REMOVED);
+}
 
-        documents_.erase(document_id);
-        document_ids_.erase(document_id);
-        document_id_to_word_freqs_.erase(document_id);
+uint32_t SearchServer::GetOrdinal(int document_id) const {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
+        throw std::out_of_range("No document with id " + std::to_string(document_id));
     }
+    return it->second;
 }
 
-void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) {
-    const std::map<std::string_view, double>& words_freqs(document_id_to_word_freqs_.at(document_id));
-    if(!words_freqs.empty()) {
-        std::vector<std::string_view> words{words_freqs.size()};
-
-        transform(policy,
-                  words_freqs.begin(), words_freqs.end(),
-                  words.begin(),
-                  [](const auto& wf){
-                      return wf.first;
-                  });
+uint32_t SearchServer::AllocateOrdinal(int document_id) {
+    uint32_t ordinal;
+    if (free_ordinals_.empty()) {
+        ordinal = static_cast<uint32_t>(ordinal_to_document_id_.size());
+        ordinal_to_document_id_.push_back(document_id);
+        document_ratings_.push_back(0);
+        document_statuses_.push_back(DocumentStatus::ACTUAL);
+        document_word_counts_.push_back(0);
+        document_term_freqs_.emplace_back();
+        document_fingerprints_.push_back(0);
+    } else {
+        ordinal = free_ordinals_.back();
+        free_ordinals_.pop_back();
+        ordinal_to_document_id_[ordinal] = document_id;
+    }
+    document_ordinals_.emplace(document_id, ordinal);
+    document_ids_.insert(document_id);
+    return ordinal;
+}
+
+void SearchServer::ReleaseOrdinal(int document_id, uint32_t ordinal) {
+    auto [first, last] = fingerprint_ordinals_.equal_range(document_fingerprints_[ordinal]);
+    for (; first != last; ++first) {
+        if (first->second == ordinal) {
+            fingerprint_ordinals_.erase(first);
+            break;
+        }
+    }
+    document_ordinals_.erase(document_id);
+    document_ids_.erase(document_id);
+    document_term_freqs_[ordinal].clear();
+    ordinal_to_document_id_[ordinal] = INVALID_DOCUMENT_ID;
+    free_ordinals_.push_back(ordinal);
+}
+
+void SearchServer::RemovePosting(TermId term, uint32_t ordinal, double term_freq) {
+    auto& postings = term_to_document_freqs_[term];
+    postings.erase(ordinal);
+
+    TermStats& stats = term_stats_[term];
+    stats.log_document_freq = postings.empty() ? 0.0 : std::log(static_cast<double>(postings.size()));
+    if (term_freq == stats.max_term_freq && --stats.max_term_freq_count == 0) {
+        stats.max_term_freq = 0.0;
+        for (const auto& [document, freq] : postings) {
+            if (freq > stats.max_term_freq) {
+                stats.max_term_freq = freq;
+                stats.max_term_freq_count = 0;
+            }
+            if (freq == stats.max_term_freq) {
+                ++stats.max_term_freq_count;
+            }
+        }
+    }
+}
 
-        std::for_each(policy,
-                      words.begin(), words.end(),
-                      [this, document_id](std::string_view item) {
-                        word_to_document_freqs_[item].erase(document_id);
-                        });
+void SearchServer::AddTermFreq(TermId term, uint32_t ordinal, double term_freq) {
+    auto& document_freqs = term_to_document_freqs_[term];
+    document_freqs.emplace_hint(document_freqs.end(), ordinal, term_freq);
 
-        documents_.erase(document_id);
-        document_ids_.erase(document_id);
-        document_id_to_word_freqs_.erase(document_id);
+    TermStats& stats = term_stats_[term];
+    stats.log_document_freq = std::log(static_cast<double>(document_freqs.size()));
+    if (term_freq > stats.max_term_freq) {
+        stats.max_term_freq = term_freq;
+        stats.max_term_freq_count = 0;
+    }
+    if (term_freq == stats.max_term_freq) {
+        ++stats.max_term_freq_count;
     }
+    RaiseBlockMax(term, ordinal, term_freq);
+}
+
+void SearchServer::RaiseBlockMax(TermId term, uint32_t ordinal, double term_freq) {
+    auto& block_maxima = term_block_maxima_[term];
+    const uint32_t block = ordinal / BLOCK_ORDINALS;
+    // ordinals mostly ascend, so the block is usually the last one or goes after it
+    auto it = block_maxima.end();
+    if (!block_maxima.empty() && block_maxima.back().block >= block) {
+        it = std::lower_bound(block_maxima.begin(), block_maxima.end(), block,
+                              [](const BlockMax& block_max, uint32_t value) {
+                                  return block_max.block < value;
+                              });
+    }
+    float bound = static_cast<float>(term_freq);
+    if (bound < term_freq) {
+        bound = std::nextafter(bound, std::numeric_limits<float>::infinity());
+    }
+    if (it == block_maxima.end() || it->block != block) {
+        block_maxima.insert(it, {block, bound});
+    } else {
+        it->max_term_freq = std::max(it->max_term_freq, bound);
+    }
+}
+
+void SearchServer::ResizeTermArrays() {
+    term_to_document_freqs_.resize(terms_.GetTermCount());
+    term_stats_.resize(terms_.GetTermCount());
+    term_block_maxima_.resize(terms_.GetTermCount());
+}
+
+void SearchServer::AddDocumentCounts(int document_id, DocumentStatus status, int rating, uint32_t word_count,
+                                     const std::vector<std::pair<std::string_view, uint32_t>>& word_counts) {
+    std::vector<std::pair<TermId, uint32_t>> term_counts;
+    term_counts.reserve(word_counts.size());
+    for (const auto& [word, count] : word_counts) {
+        term_counts.emplace_back(terms_.Intern(word), count);
+    }
+    ResizeTermArrays();
+
+    const uint32_t ordinal = AllocateOrdinal(document_id);
+    document_ratings_[ordinal] = rating;
+    document_statuses_[ordinal] = status;
+    document_word_counts_[ordinal] = word_count;
+
+    const double inv_word_count = 1.0 / static_cast<double>(word_count);
+    uint64_t fingerprint = 0;
+    for (const auto& [term, count] : term_counts) {
+        if (document_term_freqs_[ordinal].emplace(term, count * inv_word_count).second) {
+            fingerprint += GetTermFingerprint(term);
+        }
+        AddTermFreq(term, ordinal, count * inv_word_count);
+    }
+    document_fingerprints_[ordinal] = fingerprint;
+    IndexFingerprint(ordinal);
+    UpdateDocumentCount();
+}
+
+uint64_t SearchServer::GetTermFingerprint(TermId term) {
+    // splitmix64: the hashes of different terms are independent, so their sum doesn't
+    // depend on the order of the terms and rarely matches for different sets of them
+    uint64_t hash = term + 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+void SearchServer::IndexFingerprint(uint32_t ordinal) {
+    fingerprint_ordinals_.emplace(document_fingerprints_[ordinal], ordinal);
+}
+
+bool SearchServer::HaveSameTerms(uint32_t lhs, uint32_t rhs) const {
+    const auto& lhs_terms = document_term_freqs_[lhs];
+    const auto& rhs_terms = document_term_freqs_[rhs];
+    return lhs_terms.size() == rhs_terms.size()
+           && std::equal(lhs_terms.begin(), lhs_terms.end(), rhs_terms.begin(),
+                         [](const auto& lhs_term, const auto& rhs_term) {
+                             return lhs_term.first == rhs_term.first;
+                         });
+}
+
+void SearchServer::UpdateDocumentCount() {
+    const int document_count = GetDocumentCount();
+    log_document_count_ = document_count == 0 ? 0.0 : std::log(static_cast<double>(document_count));
+    ++generation_;
 }
 
 bool SearchServer::IsValidWord(std::string_view word) {
@@ -236,21 +784,32 @@ bool SearchServer::IsValidWord(std::string_view word) {
     });
 }
 
-bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(word) > 0;
+void SearchServer::AddStopWord(std::string_view word) {
+    const TermId term = terms_.Intern(word);
+    is_stop_term_.resize(terms_.GetTermCount());
+    is_stop_term_[term] = true;
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWordsStrView(text)) {
-        if(!IsValidWord(word)){
-            throw std::invalid_argument("Word is invalid: " + std::string(word));
-        }
-        if (!IsStopWord(word)) {
-            words.emplace_back(word);
+bool SearchServer::IsStopTerm(TermId term) const {
+    return term < is_stop_term_.size() && is_stop_term_[term];
+}
+
+std::vector<TermId> SearchServer::SplitIntoTermsNoStop(std::string_view text) {
+    thread_local std::vector<std::string_view> words;
+    const size_t control_position = SplitIntoWordsChecked(text, words);
+    if (control_position != text.npos) {
+        throw std::invalid_argument("Word is invalid: " + std::string(GetWordAt(text, control_position)));
+    }
+
+    std::vector<TermId> terms;
+    terms.reserve(words.size());
+    for (std::string_view word : words) {
+        const TermId term = terms_.Intern(word);
+        if (!IsStopTerm(term)) {
+            terms.push_back(term);
         }
     }
-    return words;
+    return terms;
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -273,58 +832,64 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word ) con
         word = word.substr(1);
     }
 
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+    if (word.empty() || word[0] == '-') {
         throw std::invalid_argument("Query word is invalid");
     }
 
-    return {word, is_minus, IsStopWord(word)};
+    const TermId term = terms_.Find(word);
+    return {term, is_minus, IsStopTerm(term)};
 }
 
-std::vector<std::string_view> SearchServer::SortUniq(const std::execution::sequenced_policy& policy,
-                                                     std::vector<std::string_view>& container) const {
+void SearchServer::SortUniq(const std::execution::sequenced_policy& policy,
+                            std::vector<TermId>& container) const {
 
     std::sort(policy, container.begin(), container.end());
-    auto words_end = std::unique(policy, container.begin(), container.end());
-    container.erase(words_end, container.end());
-
-    return container;
+    auto terms_end = std::unique(policy, container.begin(), container.end());
+    container.erase(terms_end, container.end());
 }
 
 SearchServer::Query SearchServer::ParseQuery(const std::execution::sequenced_policy& policy,
-                                             std::string_view text) const {
+                                             std::string_view text, StageTotals* stage_totals) const {
+    STAGE_DURATION_INTO(MetricsStage::PARSE, stage_totals);
     Query result;
-    auto words = SplitIntoWordsStrView(text);
+    thread_local std::vector<std::string_view> words;
+    if (SplitIntoWordsChecked(text, words) != text.npos) {
+        throw std::invalid_argument("Query word is invalid");
+    }
 
     for (const std::string_view word : words) {
         const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+        if (!query_word.is_stop && query_word.term != TermDictionary::NO_TERM) {
             if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+                result.minus_terms.push_back(query_word.term);
             } else {
-                result.plus_words.push_back(query_word.data);
+                result.plus_terms.push_back(query_word.term);
             }
         }
     }
 
-    result.minus_words = SortUniq(policy, result.minus_words);
-    result.plus_words = SortUniq(policy, result.plus_words);
+    SortUniq(policy, result.minus_terms);
+    SortUniq(policy, result.plus_terms);
 
     return result;
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::execution::parallel_policy& policy,
+SearchServer::Query SearchServer::ParseQuery(const std::execution::parallel_policy&,
                                              std::string_view text) const {
-
+    STAGE_DURATION(MetricsStage::PARSE);
     Query result;
-    auto words = SplitIntoWordsStrView(text);
+    thread_local std::vector<std::string_view> words;
+    if (SplitIntoWordsChecked(text, words) != text.npos) {
+        throw std::invalid_argument("Query word is invalid");
+    }
 
     for (const std::string_view word : words) {
         const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+        if (!query_word.is_stop && query_word.term != TermDictionary::NO_TERM) {
             if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+                result.minus_terms.push_back(query_word.term);
             } else {
-                result.plus_words.push_back(query_word.data);
+                result.plus_terms.push_back(query_word.term);
             }
         }
     }
@@ -332,8 +897,17 @@ SearchServer::Query SearchServer::ParseQuery(const std::execution::parallel_poli
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return std::log(SearchServer::GetDocumentCount() * 1.0 / static_cast<double> (word_to_document_freqs_.at(word).size()));
+std::vector<double> SearchServer::ComputeInverseDocumentFreqs(const Query& query) const {
+    std::vector<double> inverse_document_freqs;
+    inverse_document_freqs.reserve(query.plus_terms.size());
+    for (const TermId term : query.plus_terms) {
+        inverse_document_freqs.push_back(ComputeTermInverseDocumentFreq(term));
+    }
+    return inverse_document_freqs;
+}
+
+double SearchServer::ComputeTermInverseDocumentFreq(TermId term) const {
+    return log_document_count_ - term_stats_[term].log_document_freq;
 }
 
 
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <map>
+#include <optional>
 #include <stdexcept>
 #include <algorithm>
 #include <numeric>
@@ -12,21 +13,46 @@
 #include <execution>
 #include <iterator>
 #include <utility>
+#include <unordered_map>
 #include <unordered_set>
 #include <deque>
+#include <thread>
+#include <limits>
 
 #include "string_processing.h"
 #include "document.h"
-#include "concurrent_map.h"
-
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+#include "metrics.h"
+#include "result_cache.h"
+#include "score_accumulator.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
+#include "top_documents.h"
+
+// Passed in place of an execution policy to evaluate a query document-at-a-time with WAND:
+// documents whose score upper bound can't reach the current top are skipped without scoring.
+// Results are the same as of the exhaustive search.
+struct WandPolicy {};
+inline constexpr WandPolicy wand{};
+
+// One document of a batch passed to SearchServer::AddDocuments
+struct DocumentToAdd {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
 
 
 class SearchServer {
+    friend class FrozenSearchServer;
+    friend class SegmentedSearchServer;
+    friend class ShardedSearchServer;
+    friend class DurableSearchServer;
+    friend class NearDuplicateFinder;
+
 public:
     // You can refer to this constant as SearchServer::INVALID_DOCUMENT_ID
-    //inline static constexpr int INVALID_DOCUMENT_ID = -1
+    inline static constexpr int INVALID_DOCUMENT_ID = -1;
     //Конструктор класса
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
@@ -37,6 +63,13 @@ public:
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Adds all documents or, if any of them is invalid, none.
+    // The parallel version tokenizes parts of the batch into partial indexes simultaneously
+    // and merges them into the index by document and by term.
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+    void AddDocuments(const std::execution::sequenced_policy& policy, const std::vector<DocumentToAdd>& documents);
+    void AddDocuments(const std::execution::parallel_policy& policy, const std::vector<DocumentToAdd>& documents);
+
 
     std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy& policy,
                                            std::string_view raw_query, DocumentStatus status) const;
@@ -62,6 +95,42 @@ public:
     std::vector<Document> FindTopDocuments(std::string_view raw_query,
                                            DocumentPredicate document_predicate) const;
 
+    // Same searches returning up to result_count documents instead of MAX_RESULT_DOCUMENT_COUNT
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                           std::string_view raw_query, DocumentStatus status,
+                                           size_t result_count) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy& policy,
+                                           std::string_view raw_query, DocumentStatus status,
+                                           size_t result_count) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t result_count) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t result_count) const;
+
+    std::vector<Document> FindTopDocuments(const WandPolicy& policy,
+                                           std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(const WandPolicy& policy,
+                                           std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const WandPolicy& policy,
+                                           std::string_view raw_query, DocumentStatus status,
+                                           size_t result_count) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const WandPolicy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const WandPolicy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t result_count) const;
+
     int GetDocumentCount() const;
 
     std::set<int>::const_iterator begin() const;
@@ -83,55 +152,188 @@ public:
     void RemoveDocument(const std::execution::parallel_policy& policy,int document_id);
     void RemoveDocument(const std::execution::sequenced_policy& policy, int document_id);
 
+    // Keeps the results of up to capacity recent searches filtered by status (those without
+    // a predicate), 0 turns the cache off. Any change of the index makes the kept results stale.
+    void SetResultCacheCapacity(size_t capacity);
+
+    ResultCache::Stats GetResultCacheStats() const;
+
+    // Duplicates have the same set of words, stop words aside, whatever their order and counts.
+    // Every document keeps an order-independent 64-bit fingerprint of its set of words
+    // and an index by fingerprint, so a lookup compares the words of a handful of documents.
+
+    // The smallest id of the other documents with the same words
+    std::optional<int> FindDuplicate(int document_id) const;
+    // The smallest id of the documents with the words of a text not added yet,
+    // checking it before AddDocument lets duplicates be rejected
+    std::optional<int> FindDuplicate(std::string_view document) const;
+
+    // Ids of the documents that repeat the words of a document with a smaller id, ascending.
+    // The parallel version groups the fingerprint index by parts simultaneously.
+    std::vector<int> FindDuplicates() const;
+    std::vector<int> FindDuplicates(const std::execution::sequenced_policy& policy) const;
+    std::vector<int> FindDuplicates(const std::execution::parallel_policy& policy) const;
+
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-        std::string document;
+    TermDictionary terms_;
+    std::vector<bool> is_stop_term_;
+    // documents scored by one task of the parallel search
+    static constexpr size_t MIN_DOCUMENTS_PER_TASK = 4096;
+    // documents tokenized by one task of AddDocuments
+    static constexpr size_t MIN_DOCUMENTS_PER_BATCH_TASK = 256;
+
+    // postings are keyed by document ordinal
+    std::vector<std::map<uint32_t, double>> term_to_document_freqs_;
+
+    // Kept up to date by AddDocument and RemoveDocument for the terms of the changed document.
+    // idf = log(N / df) is read as log N - log df, so a change of the document count
+    // updates a single value instead of every term and queries call no std::log.
+    struct TermStats {
+        double log_document_freq = 0.0;
+        double max_term_freq = 0.0;
+        // documents holding max_term_freq, the postings are rescanned when the last one goes
+        uint32_t max_term_freq_count = 0;
     };
-
-    std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
+    std::vector<TermStats> term_stats_;
+    double log_document_count_ = 0.0;
+
+    // Maxima of the term frequencies over blocks of BLOCK_ORDINALS ordinals, ascending by block;
+    // only the blocks with postings of the term have one. WAND bounds the score of a block with them.
+    // Like max_term_freq they are raised on adds and kept on removals, staying upper bounds.
+    static constexpr uint32_t BLOCK_ORDINALS = 8;
+    // postings a WAND cursor steps over at most before it searches its map for a document
+    static constexpr int MAX_CURSOR_STEPS = 4;
+    // a float rounded up keeps the bound in half the size
+    struct BlockMax {
+        uint32_t block;
+        float max_term_freq;
+    };
+    std::vector<std::vector<BlockMax>> term_block_maxima_;
+
+    // Documents are addressed by dense ordinals, ordinals of removed documents are reused.
+    // The arrays below are indexed by ordinal.
+    std::unordered_map<int, uint32_t> document_ordinals_;
+    std::vector<uint32_t> free_ordinals_;
+    std::vector<int> ordinal_to_document_id_;
+    std::vector<int> document_ratings_;
+    std::vector<DocumentStatus> document_statuses_;
+    // words of the document without stop words
+    std::vector<uint32_t> document_word_counts_;
+    std::vector<std::map<TermId, double>> document_term_freqs_;
     std::set<int> document_ids_;
-    std::map<int, std::map<std::string_view, double>> document_id_to_word_freqs_;
-    std::set<std::string, std::less<>> container;
+    // sums of the hashes of the document terms
+    std::vector<uint64_t> document_fingerprints_;
+    // different sets of terms may share a fingerprint, the terms are compared on a match
+    std::unordered_multimap<uint64_t, uint32_t> fingerprint_ordinals_;
+    // fingerprint index buckets grouped by one task of FindDuplicates
+    static constexpr size_t MIN_BUCKETS_PER_TASK = 4096;
+
+    // bumped by UpdateDocumentCount, which every change of the index ends with
+    uint64_t generation_ = 0;
+    ResultCache result_cache_;
+
+    uint32_t GetOrdinal(int document_id) const;
+
+    uint32_t AllocateOrdinal(int document_id);
+
+    void ReleaseOrdinal(int document_id, uint32_t ordinal);
+
+    void RemovePosting(TermId term, uint32_t ordinal, double term_freq);
+
+    void UpdateDocumentCount();
+
+    static uint64_t GetTermFingerprint(TermId term);
+
+    // Indexes the fingerprint stored for the ordinal
+    void IndexFingerprint(uint32_t ordinal);
+
+    bool HaveSameTerms(uint32_t lhs, uint32_t rhs) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<int> FindDuplicatesIn(const ExecutionPolicy& policy) const;
+
+    void AddTermFreq(TermId term, uint32_t ordinal, double term_freq);
+
+    void RaiseBlockMax(TermId term, uint32_t ordinal, double term_freq);
+
+    // Sizes the per-term arrays for the terms interned so far
+    void ResizeTermArrays();
+
+    // Adds a document given as occurrence counts of its words, they are not checked.
+    // Merges and snapshots rebuild indexes with it, so it is not counted as an added document.
+    void AddDocumentCounts(int document_id, DocumentStatus status, int rating, uint32_t word_count,
+                           const std::vector<std::pair<std::string_view, uint32_t>>& word_counts);
 
     static bool IsValidWord(std::string_view word);
 
-    bool IsStopWord(std::string_view word) const;
+    void AddStopWord(std::string_view word);
+
+    bool IsStopTerm(TermId term) const;
+
+    std::vector<TermId> SplitIntoTermsNoStop(std::string_view text);
+
+    struct BatchPart;
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    BatchPart TokenizeBatchPart(const std::vector<DocumentToAdd>& documents, size_t first, size_t last) const;
+
+    template <typename ExecutionPolicy>
+    void AddBatch(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents);
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
     struct QueryWord {
-        std::string_view data;
+        TermId term;
         bool is_minus;
         bool is_stop;
     };
 
     QueryWord ParseQueryWord(std::string_view word) const;
 
+    // words missing from the index can't match anything and are dropped while parsing
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
     };
 
-    std::vector<std::string_view> SortUniq(const std::execution::sequenced_policy& policy,
-                                           std::vector<std::string_view>& container) const;
+    void SortUniq(const std::execution::sequenced_policy& policy,
+                  std::vector<TermId>& container) const;
 
-    Query ParseQuery(const std::execution::sequenced_policy& policy, std::string_view  text) const;
+    Query ParseQuery(const std::execution::sequenced_policy& policy, std::string_view  text,
+                     StageTotals* stage_totals = nullptr) const;
     Query ParseQuery(const std::execution::parallel_policy& policy, std::string_view text) const;
 
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    double ComputeTermInverseDocumentFreq(TermId term) const;
+
+    // idf of every plus term of the query
+    std::vector<double> ComputeInverseDocumentFreqs(const Query& query) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy& policy,
-                                           const Query& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocumentsForQuery(const std::execution::sequenced_policy& policy,
+                                                   const Query& query,
+                                                   DocumentPredicate document_predicate,
+                                                   size_t result_count) const;
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy,
-                                           const Query& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocumentsForQuery(const std::execution::parallel_policy& policy,
+                                                   const Query& query,
+                                                   DocumentPredicate document_predicate,
+                                                   size_t result_count) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsForQuery(const WandPolicy& policy,
+                                                   const Query& query,
+                                                   DocumentPredicate document_predicate,
+                                                   size_t result_count) const;
+
+    // Searches filtered by status go through the result cache when it is on
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocumentsWithStatus(const ExecutionPolicy& policy,
+                                                     std::string_view raw_query, DocumentStatus status,
+                                                     size_t result_count) const;
+
+    template <typename DocumentPredicate>
+    void AccumulateRelevance(const Query& query, const std::vector<double>& inverse_document_freqs,
+                             DocumentPredicate& document_predicate,
+                             uint32_t first_document, uint32_t last_document,
+                             ScoreAccumulator& accumulator, StageTotals* stage_totals = nullptr) const;
 
 };
 
@@ -143,7 +345,7 @@ SearchServer::SearchServer(const StringContainer& stop_words) {
             throw std::invalid_argument("Invalid Stop word");
         }
         if(!word.empty()) {
-            stop_words_.emplace(std::string(word));
+            AddStopWord(word);
         }
     }
 }
@@ -160,131 +362,383 @@ template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
                                                      std::string_view raw_query,
                                                      DocumentPredicate document_predicate) const {
-    const Query query = ParseQuery(policy,
-                                   raw_query);
-    auto matched_documents = FindAllDocuments(policy,
-                                              query,
-                                              document_predicate);
-    std::sort(policy,
-              matched_documents.begin(),
-              matched_documents.end(),
-              [](const Document& lhs, const Document& rhs) {
-                 if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                     return lhs.rating > rhs.rating;
-                 } else {
-                     return lhs.relevance > rhs.relevance;
-                 }
-              });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+    return SearchServer::FindTopDocuments(policy,
+                                          raw_query,
+                                          document_predicate,
+                                          MAX_RESULT_DOCUMENT_COUNT);
 }
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
                                                      std::string_view raw_query,
                                                      DocumentPredicate document_predicate) const {
-    const Query query = ParseQuery(std::execution::seq,
-                                   raw_query);
-
-    auto matched_documents = FindAllDocuments(policy,
-                                              query,
-                                              document_predicate);
-    std::sort(policy,
-              matched_documents.begin(), matched_documents.end(),
-              [](const Document& lhs, const Document& rhs) {
-                  if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                      return lhs.rating > rhs.rating;
-                  } else {
-                      return lhs.relevance > rhs.relevance;
-                  }
-              });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    return SearchServer::FindTopDocuments(policy,
+                                          raw_query,
+                                          document_predicate,
+                                          MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                                     std::string_view raw_query,
+                                                     DocumentPredicate document_predicate,
+                                                     size_t result_count) const {
+    return FindTopDocumentsForQuery(policy, ParseQuery(policy, raw_query), document_predicate, result_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
+                                                     std::string_view raw_query,
+                                                     DocumentPredicate document_predicate,
+                                                     size_t result_count) const {
+    return FindTopDocumentsForQuery(policy, ParseQuery(std::execution::seq, raw_query), document_predicate,
+                                    result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocumentsWithStatus(const ExecutionPolicy& policy,
+                                                               std::string_view raw_query, DocumentStatus status,
+                                                               size_t result_count) const {
+    const Query query = ParseQuery(std::execution::seq, raw_query);
+    const auto status_predicate = [status](int, DocumentStatus new_status, int) {
+        return new_status == status;
+    };
+    if (result_cache_.GetCapacity() == 0) {
+        return FindTopDocumentsForQuery(policy, query, status_predicate, result_count);
     }
-    return matched_documents;
+
+    if (auto documents = result_cache_.Find(query.plus_terms, query.minus_terms, status, result_count, generation_)) {
+        return std::move(*documents);
+    }
+    std::vector<Document> documents = FindTopDocumentsForQuery(policy, query, status_predicate, result_count);
+    result_cache_.Insert(query.plus_terms, query.minus_terms, status, result_count, generation_, documents);
+    return documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy& policy,
-                                                     const Query& query,
+std::vector<Document> SearchServer::FindTopDocumentsForQuery(const std::execution::sequenced_policy&,
+                                                             const Query& query,
+                                                             DocumentPredicate document_predicate,
+                                                             size_t result_count) const {
+    Metrics::Add(MetricsCounter::QUERIES);
+    const auto ordinal_count = static_cast<uint32_t>(ordinal_to_document_id_.size());
+    auto& accumulator = ScoreAccumulator::ForCurrentThread(0, ordinal_count);
+    AccumulateRelevance(query, ComputeInverseDocumentFreqs(query), document_predicate,
+                        0, ordinal_count, accumulator);
+
+    STAGE_DURATION(MetricsStage::TOP_K);
+    TopDocuments top(result_count);
+    accumulator.Drain([this, &top](uint32_t document, double relevance) {
+        top.Push({ordinal_to_document_id_[document],
+                  relevance,
+                  document_ratings_[document]});
+    });
+    return std::move(top).Extract();
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsForQuery(const std::execution::parallel_policy& policy,
+                                                             const Query& query,
+                                                             DocumentPredicate document_predicate,
+                                                             size_t result_count) const {
+    Metrics::Add(MetricsCounter::QUERIES);
+    const std::vector<double> inverse_document_freqs = ComputeInverseDocumentFreqs(query);
+    // the stages of all the tasks are recorded once, as for a sequential search
+    StageTotals stage_totals;
+
+    // Every task scores its own range of ordinals into its own accumulator and top,
+    // so no state is shared until the tops are merged
+    const auto ordinal_count = static_cast<uint32_t>(ordinal_to_document_id_.size());
+    const size_t task_count = std::clamp<size_t>(ordinal_count / MIN_DOCUMENTS_PER_TASK,
+                                                 1, ThreadPool::GetDefault().GetThreadCount() * 4);
+    std::vector<TopDocuments> task_tops(task_count, TopDocuments(result_count));
+
+    ForEachIndex(policy, 0, task_count, [&](size_t task) {
+        const auto first_document = static_cast<uint32_t>(ordinal_count * task / task_count);
+        const auto last_document = static_cast<uint32_t>(ordinal_count * (task + 1) / task_count);
+        auto predicate = document_predicate;
+        auto& accumulator = ScoreAccumulator::ForCurrentThread(first_document, last_document);
+        AccumulateRelevance(query, inverse_document_freqs, predicate,
+                            first_document, last_document, accumulator, &stage_totals);
+        STAGE_DURATION_INTO(MetricsStage::TOP_K, &stage_totals);
+        accumulator.Drain([this, &top = task_tops[task]](uint32_t document, double relevance) {
+            top.Push({ordinal_to_document_id_[document],
+                      relevance,
+                      document_ratings_[document]});
+        });
+    });
+
+    STAGE_DURATION_INTO(MetricsStage::TOP_K, &stage_totals);
+    TopDocuments top(result_count);
+    for (const TopDocuments& task_top : task_tops) {
+        top.Merge(task_top);
+    }
+    return std::move(top).Extract();
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const WandPolicy& policy,
+                                                     std::string_view raw_query,
                                                      DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    return SearchServer::FindTopDocuments(policy,
+                                          raw_query,
+                                          document_predicate,
+                                          MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const WandPolicy& policy,
+                                                     std::string_view raw_query,
+                                                     DocumentPredicate document_predicate,
+                                                     size_t result_count) const {
+    return FindTopDocumentsForQuery(policy, ParseQuery(std::execution::seq, raw_query), document_predicate,
+                                    result_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsForQuery(const WandPolicy&,
+                                                             const Query& query,
+                                                             DocumentPredicate document_predicate,
+                                                             size_t result_count) const {
+    Metrics::Add(MetricsCounter::QUERIES);
+    // the top is kept while the postings are walked, both count as the scan
+    STAGE_DURATION(MetricsStage::POSTING_SCAN);
+    struct Cursor {
+        const std::map<uint32_t, double>* postings;
+        std::map<uint32_t, double>::const_iterator it;
+        // the candidate documents only grow, so the block maxima are walked forward
+        std::vector<BlockMax>::const_iterator block_max;
+        std::vector<BlockMax>::const_iterator block_max_end;
+        size_t query_index;
+        double inverse_document_freq;
+        double max_score;
+        // postings per ordinal
+        double density;
+
+        uint32_t GetDocument() const {
+            return it->first;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+
+        double GetBlockScore(uint32_t block) {
+            while (block_max != block_max_end && block_max->block < block) {
+                ++block_max;
             }
+            return block_max != block_max_end && block_max->block == block
+                   ? block_max->max_term_freq * inverse_document_freq
+                   : 0.0;
         }
-    }
-
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    };
+    std::vector<Cursor> cursors;
+    cursors.reserve(query.plus_terms.size());
+    std::vector<double> inverse_document_freqs(query.plus_terms.size());
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        const TermId term = query.plus_terms[i];
+        const auto& postings = term_to_document_freqs_[term];
+        if (postings.empty()) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
-        }
+        inverse_document_freqs[i] = ComputeTermInverseDocumentFreq(term);
+        const auto& block_maxima = term_block_maxima_[term];
+        cursors.push_back({&postings, postings.begin(), block_maxima.begin(), block_maxima.end(),
+                           i, inverse_document_freqs[i], term_stats_[term].max_term_freq * inverse_document_freqs[i],
+                           static_cast<double>(postings.size()) / static_cast<double>(ordinal_to_document_id_.size())});
     }
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id,
-                                     relevance,
-                                     documents_.at(document_id).rating
-                                    });
+    // The cursors ordered by document. A step moves a prefix of them,
+    // only the moved ones are put back in place among the rest, which stay sorted.
+    std::vector<Cursor*> order;
+    order.reserve(cursors.size());
+    for (Cursor& cursor : cursors) {
+        order.push_back(&cursor);
     }
-    return matched_documents;
-}
-
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy,
-                                                     const Query& query,
-                                                     DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(16);
+    const auto is_before = [](const Cursor* lhs, const Cursor* rhs) {
+        return lhs->GetDocument() < rhs->GetDocument();
+    };
+    std::sort(order.begin(), order.end(), is_before);
 
-    std::for_each(policy,
-                  query.plus_words.begin(),
-                  query.plus_words.end(),
-                  [&](const auto word){
-        if (word_to_document_freqs_.count(word) == 0) {
+    uint64_t scanned_postings = cursors.size();
+    // dense lists reach a near document sooner by stepping than by a search from the root of the map
+    const auto advance = [&scanned_postings](Cursor& cursor, uint32_t document) {
+        if (cursor.GetDocument() >= document) {
             return;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+        if ((document - cursor.GetDocument()) * cursor.density <= MAX_CURSOR_STEPS) {
+            for (int step = 0; step < MAX_CURSOR_STEPS; ++step) {
+                ++scanned_postings;
+                if (++cursor.it == cursor.postings->end() || cursor.GetDocument() >= document) {
+                    return;
+                }
             }
         }
-    });
+        cursor.it = cursor.postings->lower_bound(document);
+        ++scanned_postings;
+    };
 
-    std::for_each(policy,
-                  query.minus_words.begin(),
-                  query.minus_words.end(),
-                  [&](const auto word) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            return;
+    // The first block from the given one where the block maxima of all cursors sum above the threshold.
+    // Only the block maxima are read, the cursors stay on their postings.
+    static constexpr uint64_t NO_BLOCK = std::numeric_limits<uint64_t>::max();
+    const auto find_block = [&cursors](uint64_t block, double threshold) {
+        while (true) {
+            double bound = 0.0;
+            uint64_t nearest_block = NO_BLOCK;
+            for (Cursor& cursor : cursors) {
+                bound += cursor.GetBlockScore(static_cast<uint32_t>(block));
+                if (cursor.block_max != cursor.block_max_end) {
+                    nearest_block = std::min<uint64_t>(nearest_block, cursor.block_max->block);
+                }
+            }
+            if (nearest_block == NO_BLOCK || bound > threshold) {
+                return nearest_block == NO_BLOCK ? NO_BLOCK : block;
+            }
+            // blocks without postings of the query are passed at once
+            block = std::max(block + 1, nearest_block);
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.Erase(document_id);
+    };
+
+    TopDocuments top(result_count);
+    std::vector<double> term_scores(query.plus_terms.size());
+    while (!order.empty() && result_count > 0) {
+        // a document ties with the worst one of a full top as soon as it comes closer than EPSILON,
+        // the bound is lowered a bit more to absorb the rounding of the sums
+        const double threshold = top.IsFull()
+                                 ? top.GetWorst().relevance - EPSILON * (1.0 + 1e-6)
+                                 : -std::numeric_limits<double>::infinity();
+        double upper_bound = 0.0;
+        size_t pivot = 0;
+        for (; pivot < order.size(); ++pivot) {
+            upper_bound += order[pivot]->max_score;
+            if (upper_bound > threshold) {
+                break;
+            }
+        }
+        if (pivot == order.size()) {
+            break;
+        }
+        const uint32_t pivot_document = order[pivot]->GetDocument();
+        // the cursors on the pivot document after the pivot score it as well
+        size_t last = pivot + 1;
+        while (last < order.size() && order[last]->GetDocument() == pivot_document) {
+            ++last;
+        }
+
+        // documents before the pivot one can't make it, and the block maxima may show
+        // that no document from the pivot one to the end of its block can either
+        const uint32_t block = pivot_document / BLOCK_ORDINALS;
+        double block_bound = 0.0;
+        for (size_t i = 0; i < last; ++i) {
+            block_bound += order[i]->GetBlockScore(block);
         }
-    });
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back({document_id,
-                                     relevance,
-                                     documents_.at(document_id).rating
-                                    });
+        // cursors [0, moved) of the order are moved by the step
+        size_t moved = last;
+        if (block_bound <= threshold) {
+            // if the other cursors can't make it up either, the whole block is passed and
+            // the next blocks are checked on the block maxima alone, not moving through the postings
+            double rest_bound = block_bound;
+            for (size_t i = last; i < order.size(); ++i) {
+                rest_bound += order[i]->GetBlockScore(block);
+            }
+            uint64_t next_document = (static_cast<uint64_t>(block) + 1) * BLOCK_ORDINALS;
+            if (rest_bound > threshold) {
+                next_document = std::min<uint64_t>(next_document, order[last]->GetDocument());
+            } else {
+                const uint64_t next_block = find_block(block + 1, threshold);
+                next_document = next_block == NO_BLOCK ? NO_BLOCK : next_block * BLOCK_ORDINALS;
+            }
+            moved = 0;
+            while (moved < order.size() && order[moved]->GetDocument() < next_document) {
+                Cursor& cursor = *order[moved++];
+                if (next_document > std::numeric_limits<uint32_t>::max()) {
+                    cursor.it = cursor.postings->end();
+                } else {
+                    advance(cursor, static_cast<uint32_t>(next_document));
+                }
+            }
+        } else if (order.front()->GetDocument() != pivot_document) {
+            for (size_t i = 0; i < pivot; ++i) {
+                advance(*order[i], pivot_document);
+            }
+            moved = pivot;
+        } else {
+            const bool is_excluded = std::any_of(query.minus_terms.begin(), query.minus_terms.end(),
+                                                 [this, pivot_document, &scanned_postings](TermId term) {
+                                                     ++scanned_postings;
+                                                     return term_to_document_freqs_[term].count(pivot_document) > 0;
+                                                 });
+            if (!is_excluded
+                && document_predicate(ordinal_to_document_id_[pivot_document],
+                                      document_statuses_[pivot_document],
+                                      document_ratings_[pivot_document])) {
+                for (size_t i = 0; i < last; ++i) {
+                    term_scores[order[i]->query_index] = order[i]->it->second * order[i]->inverse_document_freq;
+                }
+                // summed in query order like the exhaustive search does
+                double relevance = 0.0;
+                for (const double term_score : term_scores) {
+                    relevance += term_score;
+                }
+                for (size_t i = 0; i < last; ++i) {
+                    term_scores[order[i]->query_index] = 0.0;
+                }
+                top.Push({ordinal_to_document_id_[pivot_document],
+                          relevance,
+                          document_ratings_[pivot_document]});
+            }
+            for (size_t i = 0; i < last; ++i) {
+                ++order[i]->it;
+                ++scanned_postings;
+            }
+        }
+
+        // the moved cursors are inserted into the sorted rest from the last one on
+        for (size_t i = moved; i-- > 0;) {
+            const auto cursor = order.begin() + static_cast<std::ptrdiff_t>(i);
+            if ((*cursor)->it == (*cursor)->postings->end()) {
+                order.erase(cursor);
+                continue;
+            }
+            std::rotate(cursor, cursor + 1, std::lower_bound(cursor + 1, order.end(), *cursor, is_before));
+        }
     }
-    return matched_documents;
+    Metrics::Add(MetricsCounter::POSTINGS_SCANNED, scanned_postings);
+    return std::move(top).Extract();
 }
 
+// Scores documents with ordinals [first_document, last_document).
+// Minus terms go first, so that excluded documents are never scored.
+template <typename DocumentPredicate>
+void SearchServer::AccumulateRelevance(const Query& query,
+                                       const std::vector<double>& inverse_document_freqs,
+                                       DocumentPredicate& document_predicate,
+                                       uint32_t first_document, uint32_t last_document,
+                                       ScoreAccumulator& accumulator, StageTotals* stage_totals) const {
+    uint64_t scanned_postings = 0;
+    {
+        STAGE_DURATION_INTO(MetricsStage::MINUS_FILTER, stage_totals);
+        for (const TermId term : query.minus_terms) {
+            const auto& postings = term_to_document_freqs_[term];
+            for (auto it = postings.lower_bound(first_document);
+                 it != postings.end() && it->first < last_document; ++it) {
+                accumulator.Exclude(it->first);
+                ++scanned_postings;
+            }
+        }
+    }
 
-
+    STAGE_DURATION_INTO(MetricsStage::POSTING_SCAN, stage_totals);
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        const auto& postings = term_to_document_freqs_[query.plus_terms[i]];
+        const double inverse_document_freq = inverse_document_freqs[i];
+        for (auto it = postings.lower_bound(first_document);
+             it != postings.end() && it->first < last_document; ++it) {
+            const auto [document, term_freq] = *it;
+            if (!accumulator.IsExcluded(document)
+                && document_predicate(ordinal_to_document_id_[document],
+                                      document_statuses_[document],
+                                      document_ratings_[document])) {
+                accumulator.Add(document, term_freq * inverse_document_freq);
+            }
+            ++scanned_postings;
+        }
+    }
+    Metrics::Add(MetricsCounter::POSTINGS_SCANNED, scanned_postings);
+}
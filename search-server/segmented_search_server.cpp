@@ -0,0 +1,326 @@
+#include "segmented_search_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+SegmentedSearchServer::Segment::Segment(const SearchServer& search_server)
+        : index(search_server) {
+    forward_offsets.reserve(index.document_ids_.size() + 1);
+    forward_offsets.push_back(0);
+    word_counts.reserve(index.document_ids_.size());
+    for (const int document_id : index.document_ids_) {
+        const uint32_t ordinal = search_server.GetOrdinal(document_id);
+        const uint32_t word_count = search_server.document_word_counts_[ordinal];
+        for (const auto [term, term_freq] : search_server.document_term_freqs_[ordinal]) {
+            forward_terms.emplace_back(index.FindTerm(search_server.terms_.GetTerm(term)),
+                                       static_cast<uint32_t>(std::lround(term_freq * word_count)));
+        }
+        forward_offsets.push_back(forward_terms.size());
+        word_counts.push_back(word_count);
+    }
+}
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words_text, size_t seal_document_count)
+        : stop_words_text_(stop_words_text),
+          seal_document_count_(std::max<size_t>(seal_document_count, 1)),
+          mutable_segment_(stop_words_text) {
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                        const std::vector<int>& ratings) {
+    PollMerge();
+    if (document_locations_.count(document_id)) {
+        throw std::invalid_argument("id is less zero or id is present, ID: " + std::to_string(document_id));
+    }
+    mutable_segment_.AddDocument(document_id, document, status, ratings);
+    ChangeDocumentFreqs(mutable_segment_, mutable_segment_.GetOrdinal(document_id), 1);
+    document_locations_.emplace(document_id, DocumentLocation{IN_MUTABLE_SEGMENT, 0});
+
+    if (static_cast<size_t>(mutable_segment_.GetDocumentCount()) >= seal_document_count_) {
+        Seal();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    PollMerge();
+    const auto it = document_locations_.find(document_id);
+    if (it == document_locations_.end()) {
+        throw std::out_of_range("No document with id " + std::to_string(document_id));
+    }
+    const DocumentLocation location = it->second;
+    document_locations_.erase(it);
+
+    if (location.segment == IN_MUTABLE_SEGMENT) {
+        ChangeDocumentFreqs(mutable_segment_, mutable_segment_.GetOrdinal(document_id), -1);
+        mutable_segment_.RemoveDocument(document_id);
+        return;
+    }
+
+    // the postings are left as they are, only the document frequencies follow the removal
+    SealedSegment& sealed = sealed_segments_[segment_positions_.at(location.segment)];
+    sealed.tombstones[location.document] = true;
+    ++sealed.tombstone_count;
+    const Segment& segment = *sealed.segment;
+    for (size_t i = segment.forward_offsets[location.document]; i < segment.forward_offsets[location.document + 1]; ++i) {
+        --document_freqs_[sealed.global_terms[segment.forward_terms[i].first]];
+    }
+    StartMergeIfNeeded();
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                                              std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query,
+                            [status](int, DocumentStatus new_status, int)
+                            { return new_status == status; });
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
+                                                              std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query,
+                            [status](int, DocumentStatus new_status, int)
+                            { return new_status == status; });
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                              DocumentStatus status) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                                              std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::execution::parallel_policy& policy,
+                                                              std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(document_locations_.size());
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+    return sealed_segments_.size();
+}
+
+void SegmentedSearchServer::WaitForMerge() {
+    while (merge_.valid()) {
+        InstallMerge();
+    }
+}
+
+TermId SegmentedSearchServer::GetGlobalTerm(std::string_view word) {
+    const TermId term = global_terms_.Intern(word);
+    document_freqs_.resize(global_terms_.GetTermCount());
+    return term;
+}
+
+void SegmentedSearchServer::ChangeDocumentFreqs(const SearchServer& search_server, uint32_t ordinal, int delta) {
+    for (const auto [term, term_freq] : search_server.document_term_freqs_[ordinal]) {
+        document_freqs_[GetGlobalTerm(search_server.terms_.GetTerm(term))] += delta;
+    }
+}
+
+void SegmentedSearchServer::Seal() {
+    sealed_segments_.push_back(MakeSealedSegment(std::make_shared<const Segment>(mutable_segment_)));
+    mutable_segment_ = SearchServer(std::string_view(stop_words_text_));
+    segment_positions_[sealed_segments_.back().id] = sealed_segments_.size() - 1;
+    UpdateLocations(sealed_segments_.size() - 1);
+    StartMergeIfNeeded();
+}
+
+SegmentedSearchServer::SealedSegment SegmentedSearchServer::MakeSealedSegment(std::shared_ptr<const Segment> segment) {
+    SealedSegment sealed;
+    const FrozenSearchServer& index = segment->index;
+    sealed.global_terms.reserve(index.term_inverse_document_freqs_.size());
+    for (uint32_t term = 0; term < index.term_inverse_document_freqs_.size(); ++term) {
+        sealed.global_terms.push_back(GetGlobalTerm(index.GetTerm(term)));
+    }
+    sealed.tombstones.resize(index.document_ids_.size());
+    sealed.segment = std::move(segment);
+    sealed.id = next_segment_id_++;
+    return sealed;
+}
+
+void SegmentedSearchServer::UpdateLocations(size_t position) {
+    const SealedSegment& sealed = sealed_segments_[position];
+    const auto& document_ids = sealed.segment->index.document_ids_;
+    for (uint32_t document = 0; document < document_ids.size(); ++document) {
+        if (!sealed.tombstones[document]) {
+            document_locations_[document_ids[document]] = {sealed.id, document};
+        }
+    }
+}
+
+size_t SegmentedSearchServer::GetTier(const SealedSegment& sealed) const {
+    const size_t document_count = sealed.tombstones.size() - sealed.tombstone_count;
+    size_t tier = 0;
+    for (size_t limit = seal_document_count_ * MERGE_FACTOR; document_count >= limit; limit *= MERGE_FACTOR) {
+        ++tier;
+    }
+    return tier;
+}
+
+void SegmentedSearchServer::StartMergeIfNeeded() {
+    if (merge_.valid()) {
+        return;
+    }
+    size_t begin = sealed_segments_.size();
+    size_t end = begin;
+    // a segment with more removed documents than live ones is rewritten alone
+    for (size_t i = 0; i < sealed_segments_.size(); ++i) {
+        if (sealed_segments_[i].tombstone_count * 2 > sealed_segments_[i].tombstones.size()) {
+            begin = i;
+            end = i + 1;
+            break;
+        }
+    }
+    // otherwise the first MERGE_FACTOR neighbours of one tier are merged; new segments are
+    // sealed at the end and merged ones take the place of the first, so the tiers go down
+    // along sealed_segments_ and the segments of a tier stay together
+    for (size_t i = 0; begin == end && i + MERGE_FACTOR <= sealed_segments_.size(); ++i) {
+        const size_t tier = GetTier(sealed_segments_[i]);
+        size_t j = i + 1;
+        while (j < i + MERGE_FACTOR && GetTier(sealed_segments_[j]) == tier) {
+            ++j;
+        }
+        if (j == i + MERGE_FACTOR) {
+            begin = i;
+            end = j;
+        }
+    }
+    if (begin == end) {
+        return;
+    }
+
+    // the task gets the immutable segments and a copy of the tombstones as of now,
+    // documents removed while it runs are tombstoned again in the merged segment
+    std::vector<std::shared_ptr<const Segment>> segments;
+    merged_tombstones_.clear();
+    for (size_t i = begin; i < end; ++i) {
+        segments.push_back(sealed_segments_[i].segment);
+        merged_tombstones_.push_back(sealed_segments_[i].tombstones);
+    }
+    merge_begin_ = begin;
+    merge_end_ = end;
+    merge_ = std::async(std::launch::async, MergeSegments, std::move(segments), merged_tombstones_);
+}
+
+void SegmentedSearchServer::PollMerge() {
+    if (merge_.valid() && merge_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        InstallMerge();
+    }
+}
+
+void SegmentedSearchServer::InstallMerge() {
+    const std::shared_ptr<const Segment> merged = merge_.get();
+
+    std::vector<int> removed_while_merging;
+    for (size_t i = merge_begin_; i < merge_end_; ++i) {
+        const SealedSegment& sealed = sealed_segments_[i];
+        for (uint32_t document = 0; document < sealed.tombstones.size(); ++document) {
+            if (sealed.tombstones[document] && !merged_tombstones_[i - merge_begin_][document]) {
+                removed_while_merging.push_back(sealed.segment->index.document_ids_[document]);
+            }
+        }
+        segment_positions_.erase(sealed.id);
+    }
+
+    const auto merged_end = sealed_segments_.erase(sealed_segments_.begin() + merge_begin_,
+                                                   sealed_segments_.begin() + merge_end_);
+    if (!merged->index.document_ids_.empty()) {
+        SealedSegment sealed = MakeSealedSegment(merged);
+        // document frequencies were lowered at the removal already
+        for (const int document_id : removed_while_merging) {
+            sealed.tombstones[merged->index.FindDocument(document_id)] = true;
+            ++sealed.tombstone_count;
+        }
+        sealed_segments_.insert(merged_end, std::move(sealed));
+        UpdateLocations(merge_begin_);
+    }
+    // only the segments after the merged ones move
+    for (size_t i = merge_begin_; i < sealed_segments_.size(); ++i) {
+        segment_positions_[sealed_segments_[i].id] = i;
+    }
+    merged_tombstones_.clear();
+    merge_begin_ = 0;
+    merge_end_ = 0;
+
+    StartMergeIfNeeded();
+}
+
+std::shared_ptr<const SegmentedSearchServer::Segment>
+SegmentedSearchServer::MergeSegments(const std::vector<std::shared_ptr<const Segment>>& segments,
+                                     const std::vector<std::vector<bool>>& tombstones) {
+    // words are already without stop words and checked
+    SearchServer merged(std::string_view{});
+    std::vector<std::pair<std::string_view, uint32_t>> word_counts;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const Segment& segment = *segments[i];
+        const FrozenSearchServer& index = segment.index;
+        for (uint32_t document = 0; document < index.document_ids_.size(); ++document) {
+            if (tombstones[i][document]) {
+                continue;
+            }
+            word_counts.clear();
+            for (size_t j = segment.forward_offsets[document]; j < segment.forward_offsets[document + 1]; ++j) {
+                word_counts.emplace_back(index.GetTerm(segment.forward_terms[j].first), segment.forward_terms[j].second);
+            }
+            merged.AddDocumentCounts(index.document_ids_[document], index.document_statuses_[document],
+                                     index.document_ratings_[document], segment.word_counts[document],
+                                     word_counts);
+        }
+    }
+    return std::make_shared<const Segment>(merged);
+}
+
+SegmentedSearchServer::Query SegmentedSearchServer::ParseQuery(std::string_view text) const {
+    thread_local std::vector<std::string_view> words;
+    if (SplitIntoWordsChecked(text, words) != text.npos) {
+        throw std::invalid_argument("Query word is invalid");
+    }
+
+    Query result;
+    for (std::string_view word : words) {
+        if (word.empty()) {
+            throw std::invalid_argument("Query word is empty");
+        }
+        bool is_minus = false;
+        if (word[0] == '-') {
+            is_minus = true;
+            word = word.substr(1);
+        }
+        if (word.empty() || word[0] == '-') {
+            throw std::invalid_argument("Query word is invalid");
+        }
+        // every mutable segment is created with the stop words
+        if (mutable_segment_.IsStopTerm(mutable_segment_.terms_.Find(word))) {
+            continue;
+        }
+        if (is_minus) {
+            result.minus_words.push_back(word);
+        } else {
+            result.plus_words.push_back(word);
+        }
+    }
+
+    for (auto* query_words : {&result.plus_words, &result.minus_words}) {
+        std::sort(query_words->begin(), query_words->end());
+        query_words->erase(std::unique(query_words->begin(), query_words->end()), query_words->end());
+    }
+    return result;
+}
+
+std::optional<double> SegmentedSearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
+    const TermId term = global_terms_.Find(word);
+    if (term == TermDictionary::NO_TERM || document_freqs_[term] == 0) {
+        return std::nullopt;
+    }
+    return std::log(GetDocumentCount() * 1.0 / document_freqs_[term]);
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstdint>
+#include <execution>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "frozen_search_server.h"
+#include "score_accumulator.h"
+#include "search_server.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
+#include "top_documents.h"
+
+// Index of several segments. New documents go to a small mutable SearchServer, which is
+// sealed into an immutable FrozenSearchServer segment once it holds seal_document_count
+// documents. Removing a document of a sealed segment sets its tombstone bit, the postings
+// stay untouched. Segments are tiered by their live document count: a background task merges
+// MERGE_FACTOR neighbouring segments of one tier into a segment of the next tier, and rewrites
+// alone a segment with more removed documents than live ones, so every document is rewritten
+// about log(N / seal_document_count) times.
+// Document frequencies are counted over the live documents of all segments, so relevance
+// is the same as of one SearchServer holding these documents. The parallel FindTopDocuments
+// scores the segments simultaneously, every one into a top of its own.
+// Like SearchServer, the class is not thread-safe; only the merge runs on another thread.
+class SegmentedSearchServer {
+public:
+    static constexpr size_t DEFAULT_SEAL_DOCUMENT_COUNT = 4096;
+    // segments of one tier merged together; a tier k segment holds
+    // [seal_document_count * MERGE_FACTOR^k, seal_document_count * MERGE_FACTOR^(k+1)) live documents
+    static constexpr size_t MERGE_FACTOR = 4;
+
+    explicit SegmentedSearchServer(std::string_view stop_words_text,
+                                   size_t seal_document_count = DEFAULT_SEAL_DOCUMENT_COUNT);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                           std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy& policy,
+                                           std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy& policy,
+                                           std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy& policy,
+                                           std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                           std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t result_count) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t result_count) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetSegmentCount() const;
+
+    // Waits for the running merge, if any, and the merges it leads to, and puts their segments in place
+    void WaitForMerge();
+
+private:
+    static constexpr size_t IN_MUTABLE_SEGMENT = SIZE_MAX;
+
+    // Immutable part shared with the merge task
+    struct Segment {
+        FrozenSearchServer index;
+        // (segment term, occurrence count) of document i in [forward_offsets[i], forward_offsets[i + 1])
+        std::vector<size_t> forward_offsets;
+        std::vector<std::pair<uint32_t, uint32_t>> forward_terms;
+        std::vector<uint32_t> word_counts;
+
+        explicit Segment(const SearchServer& search_server);
+    };
+
+    struct SealedSegment {
+        std::shared_ptr<const Segment> segment;
+        // global term of every segment term
+        std::vector<TermId> global_terms;
+        std::vector<bool> tombstones;
+        size_t tombstone_count = 0;
+        // stays the same while the segment moves in sealed_segments_
+        size_t id = 0;
+    };
+
+    struct DocumentLocation {
+        // id of the sealed segment
+        size_t segment;
+        uint32_t document;
+    };
+
+    struct Query {
+        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> minus_words;
+    };
+
+    std::string stop_words_text_;
+    size_t seal_document_count_;
+
+    SearchServer mutable_segment_;
+    std::vector<SealedSegment> sealed_segments_;
+    // position of every sealed segment id in sealed_segments_
+    std::unordered_map<size_t, size_t> segment_positions_;
+    size_t next_segment_id_ = 0;
+    std::unordered_map<int, DocumentLocation> document_locations_;
+
+    // live documents containing every word seen so far
+    TermDictionary global_terms_;
+    std::vector<int> document_freqs_;
+
+    std::future<std::shared_ptr<const Segment>> merge_;
+    // the merge replaces sealed segments [merge_begin_, merge_end_), only new segments
+    // are added after them while it runs
+    size_t merge_begin_ = 0;
+    size_t merge_end_ = 0;
+    std::vector<std::vector<bool>> merged_tombstones_;
+
+    TermId GetGlobalTerm(std::string_view word);
+
+    void ChangeDocumentFreqs(const SearchServer& search_server, uint32_t ordinal, int delta);
+
+    void Seal();
+
+    SealedSegment MakeSealedSegment(std::shared_ptr<const Segment> segment);
+
+    // Points the live documents of the segment at the position to it
+    void UpdateLocations(size_t position);
+
+    size_t GetTier(const SealedSegment& sealed) const;
+
+    void StartMergeIfNeeded();
+
+    void PollMerge();
+
+    void InstallMerge();
+
+    static std::shared_ptr<const Segment> MergeSegments(const std::vector<std::shared_ptr<const Segment>>& segments,
+                                                        const std::vector<std::vector<bool>>& tombstones);
+
+    Query ParseQuery(std::string_view text) const;
+
+    // nothing if no live document has the word
+    std::optional<double> ComputeWordInverseDocumentFreq(std::string_view word) const;
+
+    template <typename DocumentPredicate>
+    void ScoreSealedSegment(const SealedSegment& sealed, const Query& query,
+                            const std::vector<double>& inverse_document_freqs,
+                            DocumentPredicate& document_predicate, TopDocuments& top) const;
+
+    template <typename DocumentPredicate>
+    void ScoreMutableSegment(const Query& query, const std::vector<double>& inverse_document_freqs,
+                             DocumentPredicate& document_predicate, TopDocuments& top) const;
+};
+
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const ExecutionPolicy& policy,
+                                                              std::string_view raw_query,
+                                                              DocumentPredicate document_predicate) const {
+    return FindTopDocuments(policy, raw_query, document_predicate, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                              DocumentPredicate document_predicate) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                              DocumentPredicate document_predicate,
+                                                              size_t result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, result_count);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const ExecutionPolicy& policy,
+                                                              std::string_view raw_query,
+                                                              DocumentPredicate document_predicate,
+                                                              size_t result_count) const {
+    Query query = ParseQuery(raw_query);
+    std::vector<double> inverse_document_freqs;
+    for (auto it = query.plus_words.begin(); it != query.plus_words.end();) {
+        if (const auto inverse_document_freq = ComputeWordInverseDocumentFreq(*it)) {
+            inverse_document_freqs.push_back(*inverse_document_freq);
+            ++it;
+        } else {
+            it = query.plus_words.erase(it);
+        }
+    }
+
+    // the last top is of the mutable segment
+    std::vector<TopDocuments> segment_tops(sealed_segments_.size() + 1, TopDocuments(result_count));
+    ForEachIndex(policy, 0, segment_tops.size(), [&](size_t index) {
+        auto predicate = document_predicate;
+        if (index < sealed_segments_.size()) {
+            ScoreSealedSegment(sealed_segments_[index], query, inverse_document_freqs, predicate, segment_tops[index]);
+        } else {
+            ScoreMutableSegment(query, inverse_document_freqs, predicate, segment_tops[index]);
+        }
+    });
+
+    TopDocuments top(result_count);
+    for (const TopDocuments& segment_top : segment_tops) {
+        top.Merge(segment_top);
+    }
+    return std::move(top).Extract();
+}
+
+template <typename DocumentPredicate>
+void SegmentedSearchServer::ScoreSealedSegment(const SealedSegment& sealed, const Query& query,
+                                               const std::vector<double>& inverse_document_freqs,
+                                               DocumentPredicate& document_predicate, TopDocuments& top) const {
+    const FrozenSearchServer& index = sealed.segment->index;
+    auto& accumulator = ScoreAccumulator::ForCurrentThread(0, static_cast<uint32_t>(index.document_ids_.size()));
+
+    for (const std::string_view word : query.minus_words) {
+        const uint32_t term = index.FindTerm(word);
+        if (term == FrozenSearchServer::NO_TERM) {
+            continue;
+        }
+        for (auto cursor = index.postings_.Open(term); !cursor.IsEnd(); cursor.Next()) {
+            accumulator.Exclude(cursor.GetDocument());
+        }
+    }
+
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        const uint32_t term = index.FindTerm(query.plus_words[i]);
+        if (term == FrozenSearchServer::NO_TERM) {
+            continue;
+        }
+        for (auto cursor = index.postings_.Open(term); !cursor.IsEnd(); cursor.Next()) {
+            const uint32_t document = cursor.GetDocument();
+            if (!sealed.tombstones[document]
+                && !accumulator.IsExcluded(document)
+                && document_predicate(index.document_ids_[document],
+                                      index.document_statuses_[document],
+                                      index.document_ratings_[document])) {
+                const double term_freq = cursor.GetCount() * index.document_inverse_word_counts_[document];
+                accumulator.Add(document, term_freq * inverse_document_freqs[i]);
+            }
+        }
+    }
+
+    accumulator.Drain([&index, &top](uint32_t document, double relevance) {
+        top.Push({index.document_ids_[document], relevance, index.document_ratings_[document]});
+    });
+}
+
+template <typename DocumentPredicate>
+void SegmentedSearchServer::ScoreMutableSegment(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                                DocumentPredicate& document_predicate, TopDocuments& top) const {
+    const SearchServer& index = mutable_segment_;
+    auto& accumulator = ScoreAccumulator::ForCurrentThread(
+            0, static_cast<uint32_t>(index.ordinal_to_document_id_.size()));
+
+    const auto find_postings = [&index](std::string_view word) -> const std::map<uint32_t, double>* {
+        const TermId term = index.terms_.Find(word);
+        if (term == TermDictionary::NO_TERM || term >= index.term_to_document_freqs_.size()) {
+            return nullptr;
+        }
+        return &index.term_to_document_freqs_[term];
+    };
+
+    for (const std::string_view word : query.minus_words) {
+        if (const auto* postings = find_postings(word)) {
+            for (const auto& [document, term_freq] : *postings) {
+                accumulator.Exclude(document);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        if (const auto* postings = find_postings(query.plus_words[i])) {
+            for (const auto& [document, term_freq] : *postings) {
+                if (!accumulator.IsExcluded(document)
+                    && document_predicate(index.ordinal_to_document_id_[document],
+                                          index.document_statuses_[document],
+                                          index.document_ratings_[document])) {
+                    accumulator.Add(document, term_freq * inverse_document_freqs[i]);
+                }
+            }
+        }
+    }
+
+    accumulator.Drain([&index, &top](uint32_t document, double relevance) {
+        top.Push({index.ordinal_to_document_id_[document], relevance, index.document_ratings_[document]});
+    });
+}
@@ -0,0 +1,68 @@
+#include "sharded_search_server.h"
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words_text, size_t shard_count) {
+    shards_.reserve(std::max<size_t>(shard_count, 1));
+    for (size_t i = 0; i < std::max<size_t>(shard_count, 1); ++i) {
+        shards_.push_back(std::make_unique<Shard>(stop_words_text));
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    Shard& shard = GetShard(document_id);
+    std::unique_lock lock(shard.mutex);
+    shard.search_server.AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    Shard& shard = GetShard(document_id);
+    std::unique_lock lock(shard.mutex);
+    shard.search_server.RemoveDocument(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentStatus status) const {
+    return FindTopDocuments(raw_query,
+                            [status](int, DocumentStatus new_status, int)
+                            { return new_status == status; });
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    const Shard& shard = GetShard(document_id);
+    std::shared_lock lock(shard.mutex);
+    return shard.search_server.MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    const auto locks = LockAllShards();
+    int document_count = 0;
+    for (const auto& shard : shards_) {
+        document_count += shard->search_server.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+ShardedSearchServer::Shard& ShardedSearchServer::GetShard(int document_id) const {
+    // consecutive ids are spread over all shards
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9e3779b97f4a7c15ULL;
+    return *shards_[(hash >> 32) % shards_.size()];
+}
+
+std::vector<std::shared_lock<std::shared_mutex>> ShardedSearchServer::LockAllShards() const {
+    // always in the same order, a writer holds a single shard only
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard->mutex);
+    }
+    return locks;
+}
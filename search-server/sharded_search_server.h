@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "score_accumulator.h"
+#include "search_server.h"
+#include "thread_pool.h"
+#include "top_documents.h"
+
+// Documents spread over several SearchServer shards by a hash of the id.
+// Every shard has its own lock, so a change blocks only the queries to its shard.
+// A query locks all shards for reading, sums document frequencies over them and
+// scores the shards in parallel with these global statistics, so relevance is the
+// same as of one SearchServer; the top documents of the shards are merged.
+class ShardedSearchServer {
+public:
+    explicit ShardedSearchServer(std::string_view stop_words_text,
+                                 size_t shard_count = std::max(1u, std::thread::hardware_concurrency()));
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t result_count) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+private:
+    struct alignas(64) Shard {
+        explicit Shard(std::string_view stop_words_text) : search_server(stop_words_text) {
+        }
+
+        mutable std::shared_mutex mutex;
+        SearchServer search_server;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    Shard& GetShard(int document_id) const;
+
+    std::vector<std::shared_lock<std::shared_mutex>> LockAllShards() const;
+};
+
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentPredicate document_predicate) const {
+    return FindTopDocuments(raw_query, document_predicate, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentPredicate document_predicate,
+                                                            size_t result_count) const {
+    const auto locks = LockAllShards();
+    Metrics::Add(MetricsCounter::QUERIES);
+    // the stages of all the shards are recorded once, as for a search of one server
+    StageTotals stage_totals;
+
+    // every shard parses the query against its own dictionary, words it doesn't know match nothing there
+    std::vector<SearchServer::Query> queries;
+    queries.reserve(shards_.size());
+    int document_count = 0;
+    std::unordered_map<std::string_view, int> document_freqs;
+    for (const auto& shard : shards_) {
+        const SearchServer& search_server = shard->search_server;
+        queries.push_back(search_server.ParseQuery(std::execution::seq, raw_query, &stage_totals));
+        document_count += search_server.GetDocumentCount();
+        for (const TermId term : queries.back().plus_terms) {
+            document_freqs[search_server.terms_.GetTerm(term)] +=
+                    static_cast<int>(search_server.term_to_document_freqs_[term].size());
+        }
+    }
+
+    std::vector<TopDocuments> shard_tops(shards_.size(), TopDocuments(result_count));
+    ForEachIndex(std::execution::par, 0, shards_.size(), [&](size_t index) {
+        const SearchServer& search_server = shards_[index]->search_server;
+        const SearchServer::Query& query = queries[index];
+        std::vector<double> inverse_document_freqs;
+        inverse_document_freqs.reserve(query.plus_terms.size());
+        for (const TermId term : query.plus_terms) {
+            inverse_document_freqs.push_back(
+                    std::log(document_count * 1.0 / document_freqs.at(search_server.terms_.GetTerm(term))));
+        }
+
+        const auto ordinal_count = static_cast<uint32_t>(search_server.ordinal_to_document_id_.size());
+        auto predicate = document_predicate;
+        auto& accumulator = ScoreAccumulator::ForCurrentThread(0, ordinal_count);
+        search_server.AccumulateRelevance(query, inverse_document_freqs, predicate, 0, ordinal_count, accumulator,
+                                          &stage_totals);
+        STAGE_DURATION_INTO(MetricsStage::TOP_K, &stage_totals);
+        accumulator.Drain([&search_server, &top = shard_tops[index]](uint32_t document, double relevance) {
+            top.Push({search_server.ordinal_to_document_id_[document],
+                      relevance,
+                      search_server.document_ratings_[document]});
+        });
+    });
+
+    STAGE_DURATION_INTO(MetricsStage::TOP_K, &stage_totals);
+    TopDocuments top(result_count);
+    for (const TopDocuments& shard_top : shard_tops) {
+        top.Merge(shard_top);
+    }
+    return std::move(top).Extract();
+}
@@ -4,34 +4,132 @@
 
 #include "string_processing.h"
 
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STRING_PROCESSING_X86
+#endif
+
+namespace {
+
+bool IsControl(char c) {
+    return static_cast<unsigned char>(c) < ' ';
+}
+
+// Words and control characters of text[first, text.size()), word_begin is where the current word started
+size_t SplitTail(std::string_view text, size_t first, size_t word_begin,
+                 size_t control_position, std::vector<std::string_view>& words) {
+    for (size_t pos = first; pos < text.size(); ++pos) {
+        if (text[pos] == ' ') {
+            words.push_back(text.substr(word_begin, pos - word_begin));
+            word_begin = pos + 1;
+        } else if (control_position == text.npos && IsControl(text[pos])) {
+            control_position = pos;
+        }
+    }
+    words.push_back(text.substr(word_begin));
+    return control_position;
+}
+
+size_t SplitScalar(std::string_view text, std::vector<std::string_view>& words) {
+    return SplitTail(text, 0, 0, text.npos, words);
+}
+
+#ifdef STRING_PROCESSING_X86
+
+// Bits of space_mask are the spaces of the block starting at block_begin
+template <typename Mask>
+void EmitWords(std::string_view text, size_t block_begin, Mask space_mask,
+               size_t& word_begin, std::vector<std::string_view>& words) {
+    while (space_mask != 0) {
+        const size_t pos = block_begin + __builtin_ctz(space_mask);
+        words.push_back(text.substr(word_begin, pos - word_begin));
+        word_begin = pos + 1;
+        space_mask &= space_mask - 1;
+    }
+}
+
+size_t SplitSse2(std::string_view text, std::vector<std::string_view>& words) {
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i last_control = _mm_set1_epi8(' ' - 1);
+    size_t word_begin = 0;
+    size_t control_position = text.npos;
+    size_t pos = 0;
+    for (; pos + 16 <= text.size(); pos += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        const auto space_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, spaces)));
+        // unsigned block <= 31 holds where min(block, 31) == block
+        const auto control_mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_min_epu8(block, last_control), block)));
+        if (control_mask != 0 && control_position == text.npos) {
+            control_position = pos + __builtin_ctz(control_mask);
+        }
+        EmitWords(text, pos, space_mask, word_begin, words);
+    }
+    return SplitTail(text, pos, word_begin, control_position, words);
+}
+
+__attribute__((target("avx2")))
+size_t SplitAvx2(std::string_view text, std::vector<std::string_view>& words) {
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i last_control = _mm256_set1_epi8(' ' - 1);
+    size_t word_begin = 0;
+    size_t control_position = text.npos;
+    size_t pos = 0;
+    for (; pos + 32 <= text.size(); pos += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + pos));
+        const auto space_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, spaces)));
+        const auto control_mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_min_epu8(block, last_control), block)));
+        if (control_mask != 0 && control_position == text.npos) {
+            control_position = pos + __builtin_ctz(control_mask);
+        }
+        EmitWords(text, pos, space_mask, word_begin, words);
+    }
+    return SplitTail(text, pos, word_begin, control_position, words);
+}
+
+#endif
+
+using SplitFunction = size_t (*)(std::string_view, std::vector<std::string_view>&);
+
+SplitFunction ChooseSplit() {
+#ifdef STRING_PROCESSING_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return SplitAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SplitSse2;
+    }
+#endif
+    return SplitScalar;
+}
+
+}
+
 // Разделение на слова
 std::vector<std::string> SplitIntoWords(const std::string& text) {
+    std::vector<std::string_view> word_views;
+    SplitIntoWordsChecked(text, word_views);
+
     std::vector<std::string> words;
-    std::string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
-            }
-        } else {
-            word += c;
+    for (const std::string_view word : word_views) {
+        if (!word.empty()) {
+            words.emplace_back(word);
         }
     }
-    if (!word.empty()) {
-        words.push_back(word);
-    }
-
     return words;
 }
 
 std::vector<std::string_view> SplitIntoWordsStrView(std::string_view text) {
     std::vector<std::string_view> words;
-    for (size_t pos = 0; pos != text.npos; text.remove_prefix(pos + 1)) {
-        pos = text.find(' ');
-        words.emplace_back(text.substr(0, pos));
-    }
+    SplitIntoWordsChecked(text, words);
     return words;
 }
 
-
+size_t SplitIntoWordsChecked(std::string_view text, std::vector<std::string_view>& words) {
+    static const SplitFunction split = ChooseSplit();
+    words.clear();
+    return split(text, words);
+}
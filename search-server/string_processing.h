@@ -2,6 +2,7 @@
 // Created by rustam on 06.03.2022.
 //
 #pragma once
+#include <cstddef>
 #include <vector>
 #include <set>
 #include <string>
@@ -12,6 +13,12 @@ std::vector<std::string> SplitIntoWords(const std::string& text);
 
 std::vector<std::string_view> SplitIntoWordsStrView(std::string_view text);
 
+// Splits text on every space like SplitIntoWordsStrView, replacing the content of words,
+// and checks for control characters (codes 0-31) in the same pass.
+// Returns the position of the first control character or std::string_view::npos.
+// Uses AVX2 or SSE2 where the processor has them.
+size_t SplitIntoWordsChecked(std::string_view text, std::vector<std::string_view>& words);
+
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeStringContainerNotEmpty(const StringContainer& strings) {
     std::set<std::string, std::less<>> non_empty_strings;
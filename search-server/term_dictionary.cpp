@@ -0,0 +1,89 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+TermDictionary::TermDictionary(const TermDictionary& other) {
+    *this = other;
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        // views point into the chunks of other, so the text is interned anew in the same order
+        TermDictionary copy;
+        for (const std::string_view term : other.terms_) {
+            copy.Intern(term);
+        }
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+TermId TermDictionary::Intern(std::string_view word) {
+    if ((terms_.size() + 1) * 4 > slots_.size() * 3) {
+        Grow();
+    }
+    const uint32_t hash = Hash(word);
+    Slot& slot = slots_[FindSlot(word, hash)];
+    if (slot.term == NO_TERM) {
+        slot.hash = hash;
+        slot.term = static_cast<TermId>(terms_.size());
+        terms_.push_back(Store(word));
+    }
+    return slot.term;
+}
+
+TermId TermDictionary::Find(std::string_view word) const {
+    if (slots_.empty()) {
+        return NO_TERM;
+    }
+    return slots_[FindSlot(word, Hash(word))].term;
+}
+
+uint32_t TermDictionary::Hash(std::string_view word) {
+    const uint64_t hash = std::hash<std::string_view>{}(word);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+// slots_.size() is a power of two and the table is never full,
+// so the probe stops either at the word or at an empty slot
+size_t TermDictionary::FindSlot(std::string_view word, uint32_t hash) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        const Slot& slot = slots_[index];
+        if (slot.term == NO_TERM || (slot.hash == hash && terms_[slot.term] == word)) {
+            return index;
+        }
+    }
+}
+
+std::string_view TermDictionary::Store(std::string_view word) {
+    if (chunks_.empty() || static_cast<size_t>(chunk_end_ - chunk_position_) < word.size()) {
+        // a word longer than a chunk gets a chunk of its own
+        const size_t chunk_size = std::max(CHUNK_SIZE, word.size());
+        chunks_.push_back(std::make_unique<char[]>(chunk_size));
+        chunk_position_ = chunks_.back().get();
+        chunk_end_ = chunk_position_ + chunk_size;
+    }
+    char* data = chunk_position_;
+    std::memcpy(data, word.data(), word.size());
+    chunk_position_ += word.size();
+    return {data, word.size()};
+}
+
+void TermDictionary::Grow() {
+    std::vector<Slot> slots(std::max<size_t>(slots_.size() * 2, 64));
+    const size_t mask = slots.size() - 1;
+    for (const Slot& slot : slots_) {
+        if (slot.term == NO_TERM) {
+            continue;
+        }
+        size_t index = slot.hash & mask;
+        while (slots[index].term != NO_TERM) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = slot;
+    }
+    slots_ = std::move(slots);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using TermId = uint32_t;
+
+// Interns words into dense ids 0, 1, 2, ... in order of first appearance.
+// Lookups go through an open-addressing table with linear probing that keeps
+// a part of the word hash next to the id, so most probes never touch the text.
+// Interned text lives in fixed chunks and never moves: views returned by
+// GetTerm stay valid for the dictionary lifetime.
+class TermDictionary {
+public:
+    static constexpr TermId NO_TERM = UINT32_MAX;
+
+    TermDictionary() = default;
+
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+
+    TermDictionary(TermDictionary&& other) = default;
+    TermDictionary& operator=(TermDictionary&& other) = default;
+
+    TermId Intern(std::string_view word);
+
+    TermId Find(std::string_view word) const;
+
+    std::string_view GetTerm(TermId term) const {
+        return terms_[term];
+    }
+
+    size_t GetTermCount() const {
+        return terms_.size();
+    }
+
+private:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    struct Slot {
+        uint32_t hash = 0;
+        TermId term = NO_TERM;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<std::string_view> terms_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char* chunk_position_ = nullptr;
+    char* chunk_end_ = nullptr;
+
+    static uint32_t Hash(std::string_view word);
+
+    size_t FindSlot(std::string_view word, uint32_t hash) const;
+
+    std::string_view Store(std::string_view word);
+
+    void Grow();
+};
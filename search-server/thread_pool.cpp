@@ -0,0 +1,220 @@
+#include "thread_pool.h"
+
+#include <cerrno>
+#include <system_error>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+// the pool is read on every parallel call, so it is published through an atomic
+// pointer and the mutex is only taken to create or replace it
+std::mutex default_pool_mutex;
+std::unique_ptr<ThreadPool> default_pool;
+std::atomic<ThreadPool*> default_pool_pointer = nullptr;
+
+}
+
+ThreadPool::ThreadPool(ThreadPoolOptions options)
+        : thread_count_(std::max<size_t>(options.thread_count, 1)) {
+    const size_t worker_count = thread_count_ - 1;
+    for (size_t i = 0; i <= worker_count; ++i) {
+        queues_.push_back(std::make_unique<TaskQueue>());
+    }
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkerMain, this, i);
+    }
+    if (options.pin_threads) {
+        try {
+            PinWorkers();
+        } catch (...) {
+            Stop();
+            throw;
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Stop();
+}
+
+void ThreadPool::Stop() {
+    {
+        std::lock_guard guard(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return thread_count_;
+}
+
+ThreadPool& ThreadPool::GetDefault() {
+    if (ThreadPool* const pool = default_pool_pointer.load(std::memory_order_acquire)) {
+        return *pool;
+    }
+    std::lock_guard guard(default_pool_mutex);
+    if (!default_pool) {
+        default_pool = std::make_unique<ThreadPool>();
+        default_pool_pointer.store(default_pool.get(), std::memory_order_release);
+    }
+    return *default_pool;
+}
+
+void ThreadPool::ConfigureDefault(ThreadPoolOptions options) {
+    auto pool = std::make_unique<ThreadPool>(options);
+    std::lock_guard guard(default_pool_mutex);
+    default_pool.swap(pool);
+    default_pool_pointer.store(default_pool.get(), std::memory_order_release);
+}
+
+void ThreadPool::RunLoop(Loop& loop, size_t first, size_t last) {
+    Run({&loop, first, last});
+    // the loop lives on this stack, so we help until every range of it is done; with nothing
+    // to take, the last ranges are running elsewhere and we sleep after a short spin
+    size_t idle_rounds = 0;
+    while (loop.remaining.load(std::memory_order_acquire) != 0) {
+        Task task;
+        if (TryPop(task)) {
+            Run(task);
+            idle_rounds = 0;
+        } else if (++idle_rounds < MAX_IDLE_SPINS) {
+            std::this_thread::yield();
+        } else {
+            std::unique_lock lock(sleep_mutex_);
+            wake_.wait(lock, [this, &loop] {
+                return loop.remaining.load(std::memory_order_acquire) == 0
+                       || queued_task_count_.load(std::memory_order_acquire) != 0;
+            });
+            idle_rounds = 0;
+        }
+    }
+}
+
+void ThreadPool::Run(Task task) {
+    Loop& loop = *task.loop;
+    while (task.last - task.first > loop.grain) {
+        const size_t middle = task.first + (task.last - task.first) / 2;
+        Push({task.loop, middle, task.last});
+        task.last = middle;
+    }
+    try {
+        loop.body(loop.function, task.first, task.last);
+    } catch (...) {
+        std::lock_guard guard(loop.error_mutex);
+        if (!loop.error) {
+            loop.error = std::current_exception();
+        }
+    }
+    // the loop may be gone once its counter hits zero, only the pool is touched after that
+    if (loop.remaining.fetch_sub(task.last - task.first, std::memory_order_acq_rel) == task.last - task.first) {
+        {
+            std::lock_guard guard(sleep_mutex_);
+        }
+        wake_.notify_all();
+    }
+}
+
+void ThreadPool::Push(const Task& task) {
+    TaskQueue& queue = *queues_[GetOwnQueueIndex()];
+    {
+        std::lock_guard guard(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    queued_task_count_.fetch_add(1, std::memory_order_release);
+    // taking the lock orders the push with a worker checking the count before it sleeps
+    {
+        std::lock_guard guard(sleep_mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::TryPop(Task& task) {
+    if (queued_task_count_.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    const size_t own = GetOwnQueueIndex();
+    // the own queue from the back, the newest and smallest ranges are still in the cache
+    {
+        TaskQueue& queue = *queues_[own];
+        std::lock_guard guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+            queued_task_count_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        TaskQueue& queue = *queues_[(own + i) % queues_.size()];
+        std::lock_guard guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            queued_task_count_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::PinWorkers() {
+#ifdef __linux__
+    // only the CPUs the process may run on, a container or taskset may leave out any of them
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        throw std::system_error(errno, std::generic_category(), "sched_getaffinity");
+    }
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus.push_back(cpu);
+        }
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        cpu_set_t worker_cpus;
+        CPU_ZERO(&worker_cpus);
+        CPU_SET(cpus[i % cpus.size()], &worker_cpus);
+        const int error = pthread_setaffinity_np(workers_[i].native_handle(), sizeof(worker_cpus), &worker_cpus);
+        if (error != 0) {
+            throw std::system_error(error, std::generic_category(), "pthread_setaffinity_np");
+        }
+    }
+#endif
+}
+
+void ThreadPool::WorkerMain(size_t index) {
+    current_pool = this;
+    current_worker = index;
+
+    for (;;) {
+        Task task;
+        if (TryPop(task)) {
+            Run(task);
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_.wait(lock, [this] {
+            return stopping_ || queued_task_count_.load(std::memory_order_acquire) != 0;
+        });
+        if (stopping_) {
+            return;
+        }
+    }
+}
+
+size_t ThreadPool::GetOwnQueueIndex() const {
+    return current_pool == this ? current_worker : queues_.size() - 1;
+}
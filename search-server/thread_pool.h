@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPoolOptions {
+    // threads running a loop, the thread calling ParallelFor is one of them
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    // binds the i-th worker to the i-th CPU the process may run on,
+    // so the scheduler doesn't move warm caches around
+    bool pin_threads = false;
+};
+
+// Work-stealing executor of parallel loops. A loop starts as one range; whoever runs
+// a range keeps splitting it in halves down to the grain, pushing the upper halves to the
+// back of its own queue and going on with the lower ones. A worker takes tasks from the
+// back of its queue and, when it runs dry, steals from the front of the others', where
+// the largest ranges are. The calling thread runs tasks too until its loop is done,
+// so loops nested in a task never wait for a free thread.
+class ThreadPool {
+public:
+    // Throws std::system_error if the workers can't be pinned
+    explicit ThreadPool(ThreadPoolOptions options = {});
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+    size_t GetThreadCount() const;
+
+    // Calls function(i) for every i in [first, last); the first exception thrown is rethrown
+    template <typename Function>
+    void ParallelFor(size_t first, size_t last, const Function& function);
+
+    // The pool behind the parallel overloads of the search servers
+    static ThreadPool& GetDefault();
+
+    // Replaces the default pool, no parallel call may be running meanwhile
+    static void ConfigureDefault(ThreadPoolOptions options);
+
+private:
+    // rounds a thread waiting for its loop yields before it sleeps
+    static constexpr size_t MAX_IDLE_SPINS = 64;
+
+    struct Loop {
+        void (*body)(const void* function, size_t first, size_t last);
+        const void* function;
+        size_t grain;
+        std::atomic<size_t> remaining;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+
+    struct Task {
+        Loop* loop;
+        size_t first;
+        size_t last;
+    };
+
+    struct alignas(64) TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    size_t thread_count_;
+    // a queue per worker and the last one for the threads outside the pool
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_task_count_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    void Stop();
+    void PinWorkers();
+    void RunLoop(Loop& loop, size_t first, size_t last);
+    void Run(Task task);
+    void Push(const Task& task);
+    bool TryPop(Task& task);
+    void WorkerMain(size_t index);
+    size_t GetOwnQueueIndex() const;
+};
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t first, size_t last, const Function& function) {
+    if (first >= last) {
+        return;
+    }
+    // a few ranges per thread leave room for stealing when ranges take different time
+    const size_t grain = std::max<size_t>(1, (last - first) / (thread_count_ * 8));
+    if (workers_.empty() || last - first <= grain) {
+        for (size_t i = first; i < last; ++i) {
+            function(i);
+        }
+        return;
+    }
+
+    Loop loop;
+    loop.body = [](const void* erased_function, size_t range_first, size_t range_last) {
+        const auto& typed_function = *static_cast<const Function*>(erased_function);
+        for (size_t i = range_first; i < range_last; ++i) {
+            typed_function(i);
+        }
+    };
+    loop.function = &function;
+    loop.grain = grain;
+    loop.remaining = last - first;
+    RunLoop(loop, first, last);
+    if (loop.error) {
+        std::rethrow_exception(loop.error);
+    }
+}
+
+// Runs function(i) for every i in [first, last): in order for seq, on the default pool for par
+template <typename Function>
+void ForEachIndex(const std::execution::sequenced_policy&, size_t first, size_t last, const Function& function) {
+    for (size_t i = first; i < last; ++i) {
+        function(i);
+    }
+}
+
+template <typename Function>
+void ForEachIndex(const std::execution::parallel_policy&, size_t first, size_t last, const Function& function) {
+    ThreadPool::GetDefault().ParallelFor(first, last, function);
+}
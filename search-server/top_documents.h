@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "document.h"
+
+const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const double EPSILON = 1e-6;
+
+// Result order: relevances closer than EPSILON are ordered by rating,
+// full ties by id so that every search path returns them the same way
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+// Keeps the best `count` documents pushed so far.
+// The worst of them sits on top of the heap, so a candidate is checked against it in O(1).
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t count)
+            : count_(count) {
+        // a large count is only a bound, the heap grows with the documents pushed
+        heap_.reserve(std::min<size_t>(count, MAX_RESERVED_COUNT));
+    }
+
+    void Push(const Document& document) {
+        if (heap_.size() < count_) {
+            heap_.push_back(document);
+            std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        } else if (count_ > 0 && IsMoreRelevant(document, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+            heap_.back() = document;
+            std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        }
+    }
+
+    bool IsFull() const {
+        return heap_.size() == count_;
+    }
+
+    // the document a candidate has to beat; valid only when IsFull()
+    const Document& GetWorst() const {
+        return heap_.front();
+    }
+
+    void Merge(const TopDocuments& other) {
+        for (const Document& document : other.heap_) {
+            Push(document);
+        }
+    }
+
+    // best first
+    std::vector<Document> Extract() && {
+        std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        return std::move(heap_);
+    }
+
+private:
+    static constexpr size_t MAX_RESERVED_COUNT = MAX_RESULT_DOCUMENT_COUNT * 4;
+
+    size_t count_;
+    std::vector<Document> heap_;
+};
@@ -0,0 +1,73 @@
+#include "versioned_search_server.h"
+
+#include <thread>
+
+VersionedSearchServer::Snapshot::Snapshot(const SearchServer& search_server, std::atomic<int>& readers)
+        : search_server_(&search_server),
+          readers_(&readers) {
+}
+
+VersionedSearchServer::Snapshot::Snapshot(Snapshot&& other) noexcept
+        : search_server_(other.search_server_),
+          readers_(other.readers_) {
+    other.readers_ = nullptr;
+}
+
+VersionedSearchServer::Snapshot::~Snapshot() {
+    if (readers_ != nullptr) {
+        readers_->fetch_sub(1, std::memory_order_release);
+    }
+}
+
+VersionedSearchServer::VersionedSearchServer(const SearchServer& search_server)
+        : versions_{Version(search_server), Version(search_server)} {
+}
+
+VersionedSearchServer::Snapshot VersionedSearchServer::GetSnapshot() const {
+    for (;;) {
+        const size_t active = active_.load(std::memory_order_seq_cst);
+        const Version& version = versions_[active];
+        version.readers.fetch_add(1, std::memory_order_seq_cst);
+        // if the version is still active, the writer switching away from it will see our mark
+        if (active_.load(std::memory_order_seq_cst) == active) {
+            return Snapshot(version.search_server, version.readers);
+        }
+        version.readers.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void VersionedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                        const std::vector<int>& ratings) {
+    Write([document_id, document, status, &ratings](SearchServer& search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void VersionedSearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents) {
+    Write([&documents](SearchServer& search_server) {
+        search_server.AddDocuments(std::execution::par, documents);
+    });
+}
+
+void VersionedSearchServer::RemoveDocument(int document_id) {
+    Write([document_id](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+    });
+}
+
+void VersionedSearchServer::Write(const std::function<void(SearchServer&)>& change) {
+    std::lock_guard guard(write_mutex_);
+    const size_t active = active_.load(std::memory_order_relaxed);
+
+    // SearchServer rejects invalid changes before modifying anything, so if the
+    // inactive copy throws, both copies stay equal and nothing is published
+    change(versions_[1 - active].search_server);
+    active_.store(1 - active, std::memory_order_seq_cst);
+
+    // seq_cst like the store above and the reader's increment and re-check: with a weaker
+    // load the writer could miss a reader that saw the old version still active
+    while (versions_[active].readers.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    change(versions_[active].search_server);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+// SearchServer that answers queries while documents are added and removed.
+// Two copies of the index are kept (the left-right scheme): readers pin the active one
+// and never wait, a writer changes the other one, makes it active, waits for the
+// readers still pinning the old one and repeats the change on it.
+// Readers see every change completely or not at all.
+class VersionedSearchServer {
+public:
+    // Read access to one version of the index, it doesn't change while the snapshot is alive
+    class Snapshot {
+    public:
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        Snapshot(Snapshot&& other) noexcept;
+
+        ~Snapshot();
+
+        const SearchServer& operator*() const {
+            return *search_server_;
+        }
+
+        const SearchServer* operator->() const {
+            return search_server_;
+        }
+
+    private:
+        friend class VersionedSearchServer;
+
+        Snapshot(const SearchServer& search_server, std::atomic<int>& readers);
+
+        const SearchServer* search_server_;
+        std::atomic<int>* readers_;
+    };
+
+    explicit VersionedSearchServer(const SearchServer& search_server);
+
+    Snapshot GetSnapshot() const;
+
+    // Writers are serialized with each other; they wait for the readers of the previous
+    // version, so a long-lived snapshot delays the next change.
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    void RemoveDocument(int document_id);
+
+private:
+    struct alignas(64) Version {
+        explicit Version(const SearchServer& search_server) : search_server(search_server) {
+        }
+
+        SearchServer search_server;
+        mutable std::atomic<int> readers{0};
+    };
+
+    std::array<Version, 2> versions_;
+    std::atomic<size_t> active_{0};
+    std::mutex write_mutex_;
+
+    void Write(const std::function<void(SearchServer&)>& change);
+};
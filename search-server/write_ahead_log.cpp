@@ -0,0 +1,221 @@
+#include "write_ahead_log.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// record size, sequence number and checksum of both and the record
+constexpr size_t FRAME_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint64_t);
+
+uint64_t ComputeChecksum(uint64_t sequence_number, std::string_view record) {
+    // FNV-1a over the bytes, seeded with the sequence number
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (sequence_number * 0x9e3779b97f4a7c15ULL);
+    for (const char c : record) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+void AppendValue(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T ReadValue(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+bool WriteAll(int file, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = write(file, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+bool SyncDirectory(const std::string& path) {
+    const std::string directory = std::filesystem::path(path).parent_path().string();
+    const int file = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    const bool synced = file >= 0 && fsync(file) == 0;
+    if (file >= 0) {
+        close(file);
+    }
+    return synced;
+}
+
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& path, uint64_t next_sequence_number, WriteAheadLogOptions options)
+        : path_(path),
+          options_(options),
+          last_appended_(next_sequence_number - 1),
+          last_durable_(next_sequence_number - 1) {
+    file_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (file_ < 0) {
+        throw std::runtime_error("Can't open write-ahead log " + path);
+    }
+    // the entry of a just created log must outlive a crash as well as its records
+    if (options_.sync && !SyncDirectory(path)) {
+        close(file_);
+        throw std::runtime_error("Can't sync the directory of write-ahead log " + path);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    std::unique_lock lock(mutex_);
+    committed_.wait(lock, [this] { return !committing_; });
+    if (!failed_ && !pending_.empty()) {
+        WriteAll(file_, pending_);
+        if (options_.sync) {
+            fdatasync(file_);
+        }
+    }
+    close(file_);
+}
+
+uint64_t WriteAheadLog::Append(std::string_view record) {
+    std::lock_guard guard(mutex_);
+    if (failed_) {
+        throw std::runtime_error("Write-ahead log " + path_ + " failed");
+    }
+    const uint64_t sequence_number = last_appended_ + 1;
+    AppendValue(pending_, static_cast<uint32_t>(record.size()));
+    AppendValue(pending_, sequence_number);
+    AppendValue(pending_, ComputeChecksum(sequence_number, record));
+    pending_.append(record);
+    last_appended_ = sequence_number;
+    if (++pending_count_ >= options_.max_group_size) {
+        group_ready_.notify_one();
+    }
+    return sequence_number;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t sequence_number) {
+    std::unique_lock lock(mutex_);
+    while (last_durable_ < sequence_number) {
+        if (failed_) {
+            throw std::runtime_error("Write-ahead log " + path_ + " failed");
+        }
+        if (committing_) {
+            committed_.wait(lock);
+        } else {
+            Commit(lock);
+        }
+    }
+}
+
+void WriteAheadLog::Truncate(uint64_t covered_sequence_number) {
+    std::unique_lock lock(mutex_);
+    committed_.wait(lock, [this] { return !committing_; });
+    if (covered_sequence_number > last_appended_) {
+        throw std::invalid_argument("Write-ahead log " + path_ + " has no record "
+                                    + std::to_string(covered_sequence_number));
+    }
+    if (covered_sequence_number < last_durable_) {
+        throw std::invalid_argument("Truncating write-ahead log " + path_ + " would lose the written records after "
+                                    + std::to_string(covered_sequence_number));
+    }
+    if (ftruncate(file_, 0) != 0 || (options_.sync && fdatasync(file_) != 0)) {
+        failed_ = true;
+        committed_.notify_all();
+        throw std::runtime_error("Can't truncate write-ahead log " + path_);
+    }
+    // the pending records ascend, the covered ones are a prefix of them
+    size_t covered_size = 0;
+    while (covered_size < pending_.size()
+           && ReadValue<uint64_t>(pending_.data() + covered_size + sizeof(uint32_t)) <= covered_sequence_number) {
+        covered_size += FRAME_HEADER_SIZE + ReadValue<uint32_t>(pending_.data() + covered_size);
+        --pending_count_;
+    }
+    pending_.erase(0, covered_size);
+    last_durable_ = covered_sequence_number;
+    committed_.notify_all();
+}
+
+uint64_t WriteAheadLog::GetLastSequenceNumber() const {
+    std::lock_guard guard(mutex_);
+    return last_appended_;
+}
+
+uint64_t WriteAheadLog::GetCommitCount() const {
+    std::lock_guard guard(mutex_);
+    return commit_count_;
+}
+
+void WriteAheadLog::Commit(std::unique_lock<std::mutex>& lock) {
+    committing_ = true;
+    if (options_.group_commit_delay.count() > 0) {
+        group_ready_.wait_for(lock, options_.group_commit_delay,
+                              [this] { return pending_count_ >= options_.max_group_size; });
+    }
+    const std::string records = std::move(pending_);
+    pending_.clear();
+    pending_count_ = 0;
+    const uint64_t last_sequence_number = last_appended_;
+
+    // writers keep appending to the next group meanwhile
+    lock.unlock();
+    const bool written = WriteAll(file_, records) && (!options_.sync || fdatasync(file_) == 0);
+    lock.lock();
+
+    committing_ = false;
+    if (written) {
+        last_durable_ = last_sequence_number;
+        ++commit_count_;
+    } else {
+        failed_ = true;
+    }
+    committed_.notify_all();
+}
+
+uint64_t WriteAheadLog::Replay(const std::string& path,
+                               const std::function<void(uint64_t sequence_number, std::string_view record)>& handler) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return 0;
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    uint64_t last_sequence_number = 0;
+    size_t position = 0;
+    while (data.size() - position >= FRAME_HEADER_SIZE) {
+        const auto size = ReadValue<uint32_t>(data.data() + position);
+        const auto sequence_number = ReadValue<uint64_t>(data.data() + position + sizeof(uint32_t));
+        const auto checksum = ReadValue<uint64_t>(data.data() + position + sizeof(uint32_t) + sizeof(uint64_t));
+        if (data.size() - position - FRAME_HEADER_SIZE < size) {
+            break;
+        }
+        const std::string_view record(data.data() + position + FRAME_HEADER_SIZE, size);
+        if (checksum != ComputeChecksum(sequence_number, record)
+            || (last_sequence_number != 0 && sequence_number != last_sequence_number + 1)) {
+            break;
+        }
+        handler(sequence_number, record);
+        last_sequence_number = sequence_number;
+        position += FRAME_HEADER_SIZE + size;
+    }
+
+    // the records after a torn one were never acknowledged, they go
+    if (position != data.size() && truncate(path.c_str(), static_cast<off_t>(position)) != 0) {
+        throw std::runtime_error("Can't cut the damaged tail of write-ahead log " + path);
+    }
+    return last_sequence_number;
+}
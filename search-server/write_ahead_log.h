@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+struct WriteAheadLogOptions {
+    // false leaves writing the records to disk to the OS, a crash of the machine may lose them
+    bool sync = true;
+    // how long the writer starting a group commit waits for others to join it
+    std::chrono::microseconds group_commit_delay{0};
+    // the writer stops waiting once this many records are ready
+    size_t max_group_size = 1024;
+};
+
+// Append-only log of records, each framed with its size, sequence number and checksum.
+// Append only buffers a record; WaitDurable makes it durable. Writers waiting at the same
+// time share a single write and fsync (group commit): the first of them writes out
+// everything appended so far, the others wait for it and find their records done.
+class WriteAheadLog {
+public:
+    // Continues the log at path, the records appended get sequence numbers from next_sequence_number
+    WriteAheadLog(const std::string& path, uint64_t next_sequence_number, WriteAheadLogOptions options = {});
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    ~WriteAheadLog();
+
+    // Returns the sequence number of the record
+    uint64_t Append(std::string_view record);
+
+    // Returns when the records up to sequence_number are written, and synced if the options say so
+    void WaitDurable(uint64_t sequence_number);
+
+    // Drops the records up to covered_sequence_number, which a snapshot saved by the caller holds,
+    // and reports them durable to their writers; the records after it stay to be written.
+    // Throws std::invalid_argument if the log has already written records the snapshot lacks,
+    // or if the number was never appended. The sequence numbers go on.
+    void Truncate(uint64_t covered_sequence_number);
+
+    uint64_t GetLastSequenceNumber() const;
+
+    // Number of writes to the file, each is one group of records
+    uint64_t GetCommitCount() const;
+
+    // Calls handler for every whole record of the log at path in order and cuts off a torn
+    // or damaged tail left by a crash. Returns the last sequence number read, 0 if none.
+    static uint64_t Replay(const std::string& path,
+                           const std::function<void(uint64_t sequence_number, std::string_view record)>& handler);
+
+private:
+    std::string path_;
+    WriteAheadLogOptions options_;
+    int file_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable group_ready_;
+    std::condition_variable committed_;
+    // framed records not written yet
+    std::string pending_;
+    size_t pending_count_ = 0;
+    uint64_t last_appended_;
+    uint64_t last_durable_;
+    uint64_t commit_count_ = 0;
+    bool committing_ = false;
+    bool failed_ = false;
+
+    void Commit(std::unique_lock<std::mutex>& lock);
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "frozen_search_server.h"
+#include "search_server.h"
+#include "test_Unit.h"
+#include "words_generator.h"
+
+using namespace std;
+
+vector<DocumentToAdd> MakeBatch(const vector<string>& documents, int first_id) {
+    vector<DocumentToAdd> batch;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.push_back({first_id + static_cast<int>(i), documents[i],
+                         static_cast<DocumentStatus>(i % 3), {static_cast<int>(i % 10), 3}});
+    }
+    return batch;
+}
+
+void TestAddDocumentsMatchesAddDocument() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 500, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 3'000, 20);
+
+    SearchServer one_by_one(dictionary[0] + " "s + dictionary[1]);
+    SearchServer seq_batch(dictionary[0] + " "s + dictionary[1]);
+    SearchServer par_batch(dictionary[0] + " "s + dictionary[1]);
+    const auto batch = MakeBatch(documents, 5);
+    for (const DocumentToAdd& document : batch) {
+        one_by_one.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    // a removed ordinal is reused by the batch
+    par_batch.AddDocument(1, dictionary[2], DocumentStatus::ACTUAL, {});
+    par_batch.RemoveDocument(1);
+    seq_batch.AddDocuments(batch);
+    par_batch.AddDocuments(execution::par, batch);
+
+    ASSERT_EQUAL(par_batch.GetDocumentCount(), one_by_one.GetDocumentCount());
+    ASSERT(vector<int>(par_batch.begin(), par_batch.end()) == vector<int>(one_by_one.begin(), one_by_one.end()));
+    for (int i = 0; i < 100; ++i) {
+        const string query = GenerateQuery(generator, dictionary, 6, 0.2);
+        AssertSameTop(one_by_one.FindTopDocuments(query), seq_batch.FindTopDocuments(query));
+        AssertSameTop(one_by_one.FindTopDocuments(execution::par, query, DocumentStatus::BANNED),
+                      par_batch.FindTopDocuments(execution::par, query, DocumentStatus::BANNED));
+        AssertSameTop(one_by_one.FindTopDocuments(query), par_batch.FindTopDocuments(wand, query));
+        AssertSameTop(one_by_one.FindTopDocuments(query), FrozenSearchServer(par_batch).FindTopDocuments(query));
+
+        const int document_id = uniform_int_distribution(5, 3'004)(generator);
+        ASSERT(one_by_one.MatchDocument(query, document_id) == par_batch.MatchDocument(query, document_id));
+        ASSERT_EQUAL(one_by_one.GetWordFrequencies(document_id).size(),
+                     par_batch.GetWordFrequencies(document_id).size());
+    }
+}
+
+void TestAddDocumentsIsAllOrNothing() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+
+    const vector<vector<DocumentToAdd>> invalid_batches = {
+            {{2, "funny pet"s, DocumentStatus::ACTUAL, {1}}, {1, "nasty rat"s, DocumentStatus::ACTUAL, {1}}},
+            {{2, "funny pet"s, DocumentStatus::ACTUAL, {1}}, {2, "nasty rat"s, DocumentStatus::ACTUAL, {1}}},
+            {{2, "funny pet"s, DocumentStatus::ACTUAL, {1}}, {-3, "nasty rat"s, DocumentStatus::ACTUAL, {1}}},
+            {{2, "funny pet"s, DocumentStatus::ACTUAL, {1}}, {3, "nasty r\x12t"s, DocumentStatus::ACTUAL, {1}}},
+    };
+    for (const auto& batch : invalid_batches) {
+        bool thrown = false;
+        try {
+            search_server.AddDocuments(execution::par, batch);
+        } catch (const invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+        ASSERT(search_server.FindTopDocuments("funny"s).empty());
+    }
+
+    search_server.AddDocuments(execution::par, {});
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+}
+
+void Test_AddDocuments() {
+    RUN_TEST(TestAddDocumentsMatchesAddDocument);
+    RUN_TEST(TestAddDocumentsIsAllOrNothing);
+}
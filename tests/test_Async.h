@@ -0,0 +1,242 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "async_search_server.h"
+#include "bounded_queue.h"
+#include "search_server.h"
+#include "test_FindTop.h"
+#include "test_Unit.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestBoundedQueueFromManyThreads() {
+    BoundedQueue<int> queue(5);
+    ASSERT_EQUAL(queue.GetCapacity(), 8u);
+
+    const int producer_count = 4;
+    const int value_count = 20'000;
+    atomic<long long> sum = 0;
+    vector<thread> consumers;
+    for (int i = 0; i < 3; ++i) {
+        consumers.emplace_back([&queue, &sum] {
+            int value;
+            while (queue.Pop(value)) {
+                sum.fetch_add(value, memory_order_relaxed);
+            }
+        });
+    }
+    vector<thread> producers;
+    for (int i = 0; i < producer_count; ++i) {
+        producers.emplace_back([&queue] {
+            for (int value = 1; value <= value_count; ++value) {
+                int pushed = value;
+                ASSERT(queue.Push(pushed));
+            }
+        });
+    }
+    for (thread& producer : producers) {
+        producer.join();
+    }
+    queue.Close();
+    for (thread& consumer : consumers) {
+        consumer.join();
+    }
+    ASSERT_EQUAL(sum.load(), producer_count * (value_count * (value_count + 1LL) / 2));
+
+    int value = 1;
+    ASSERT_HINT(!queue.TryPush(value), "a closed queue takes nothing"s);
+}
+
+void TestBoundedQueueCloseWhilePushing() {
+    // every value a push reports as queued must reach a consumer, however the push and Close interleave
+    for (int round = 0; round < 2'000; ++round) {
+        BoundedQueue<int> queue(1024);
+        atomic<int> pushed_count = 0;
+        atomic<int> popped_count = 0;
+        vector<thread> threads;
+        for (int i = 0; i < 2; ++i) {
+            threads.emplace_back([&queue, &popped_count] {
+                int value;
+                while (queue.Pop(value)) {
+                    popped_count.fetch_add(1, memory_order_relaxed);
+                }
+            });
+            threads.emplace_back([&queue, &pushed_count] {
+                for (int value = 0; value < 300; ++value) {
+                    int pushed = value;
+                    if (value % 2 == 0 ? queue.TryPush(pushed) : queue.Push(pushed)) {
+                        pushed_count.fetch_add(1, memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        this_thread::yield();
+        queue.Close();
+        for (thread& thread : threads) {
+            thread.join();
+        }
+        ASSERT_EQUAL(popped_count.load(), pushed_count.load());
+    }
+}
+
+void TestAsyncMatchesSearchServer() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 1'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 5'000, 30);
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], static_cast<DocumentStatus>(i % 2), {1, 2});
+    }
+    vector<string> queries;
+    for (int i = 0; i < 300; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 7, 0.1));
+    }
+
+    AsyncSearchOptions options;
+    options.thread_count = 3;
+    options.queue_capacity = 16;
+    AsyncSearchServer async_server(search_server, options);
+    ASSERT_EQUAL(async_server.GetThreadCount(), 3u);
+    ASSERT_EQUAL(async_server.GetQueueCapacity(), 16u);
+
+    vector<future<vector<Document>>> results;
+    for (const string& query : queries) {
+        results.push_back(async_server.SubmitFindTop(query, DocumentStatus::IRRELEVANT));
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+        AssertSameTop(search_server.FindTopDocuments(queries[i], DocumentStatus::IRRELEVANT), results[i].get());
+    }
+
+    bool thrown = false;
+    try {
+        async_server.SubmitFindTop("curly --cat"s).get();
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "an invalid query must fail its future"s);
+
+    promise<exception_ptr> error;
+    async_server.SubmitFindTop("curly -"s, DocumentStatus::ACTUAL, [&error](vector<Document>, exception_ptr e) {
+        error.set_value(e);
+    });
+    ASSERT(error.get_future().get() != nullptr);
+}
+
+void TestAsyncRejectsWhenFull() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+
+    AsyncSearchOptions options;
+    options.thread_count = 1;
+    options.queue_capacity = 2;
+    atomic<int> answered = 0;
+    future<vector<Document>> blocked_result;
+    {
+        AsyncSearchServer async_server(search_server, options);
+
+        // the only thread stays in the callback until released
+        promise<void> started;
+        promise<void> release;
+        shared_future<void> released = release.get_future().share();
+        async_server.SubmitFindTop("cat"s, DocumentStatus::ACTUAL, [&](vector<Document>, exception_ptr) {
+            started.set_value();
+            released.wait();
+            ++answered;
+        });
+        started.get_future().wait();
+
+        const auto count = [&answered](vector<Document> documents, exception_ptr) {
+            ASSERT_EQUAL(documents.size(), 1u);
+            ++answered;
+        };
+        ASSERT(async_server.TrySubmitFindTop("cat"s, DocumentStatus::ACTUAL, count));
+        ASSERT(async_server.TrySubmitFindTop("curly"s).has_value());
+        ASSERT_HINT(!async_server.TrySubmitFindTop("cat"s, DocumentStatus::ACTUAL, count), "the queue is full"s);
+        ASSERT(!async_server.TrySubmitFindTop("curly"s).has_value());
+
+        // backpressure: the submitting thread waits for room
+        promise<void> submitted;
+        thread client([&] {
+            blocked_result = async_server.SubmitFindTop("curly cat"s);
+            submitted.set_value();
+        });
+        auto submitted_future = submitted.get_future();
+        ASSERT(submitted_future.wait_for(20ms) == future_status::timeout);
+        release.set_value();
+        submitted_future.wait();
+        client.join();
+        // the destructor answers what is still queued
+    }
+    ASSERT_EQUAL(answered.load(), 2);
+    ASSERT_EQUAL(blocked_result.get().size(), 1u);
+}
+
+void TestAsyncFailsSubmissionsWhenStopping() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+
+    AsyncSearchOptions options;
+    options.thread_count = 1;
+    options.queue_capacity = 2;
+    auto async_server = make_unique<AsyncSearchServer>(search_server, options);
+
+    // the only thread stays in the callback and the queue is full
+    promise<void> started;
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    async_server->SubmitFindTop("cat"s, DocumentStatus::ACTUAL, [&](vector<Document>, exception_ptr) {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+    vector<future<vector<Document>>> queued;
+    for (size_t i = 0; i < async_server->GetQueueCapacity(); ++i) {
+        queued.push_back(async_server->SubmitFindTop("cat"s));
+    }
+
+    // a submission waiting for room, or coming after the queue is closed, is failed
+    // the destructor waits for the thread in the callback, so the object outlives the client
+    AsyncSearchServer* const stopping_server = async_server.get();
+    future<vector<Document>> blocked_result;
+    exception_ptr callback_error;
+    thread client([&] {
+        blocked_result = stopping_server->SubmitFindTop("curly cat"s);
+        stopping_server->SubmitFindTop("curly"s, DocumentStatus::ACTUAL, [&](vector<Document>, exception_ptr error) {
+            callback_error = error;
+        });
+    });
+    thread stopper([&] {
+        async_server.reset();
+    });
+    client.join();
+    release.set_value();
+    stopper.join();
+
+    // the queries queued before are answered
+    for (auto& result : queued) {
+        ASSERT_EQUAL(result.get().size(), 1u);
+    }
+    bool thrown = false;
+    try {
+        blocked_result.get();
+    } catch (const runtime_error&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "a submission the stopped queue refused must fail its future"s);
+    ASSERT(callback_error != nullptr);
+}
+
+void Test_AsyncSearchServer() {
+    RUN_TEST(TestBoundedQueueFromManyThreads);
+    RUN_TEST(TestBoundedQueueCloseWhilePushing);
+    RUN_TEST(TestAsyncMatchesSearchServer);
+    RUN_TEST(TestAsyncRejectsWhenFull);
+    RUN_TEST(TestAsyncFailsSubmissionsWhenStopping);
+}
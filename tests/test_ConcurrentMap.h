@@ -0,0 +1,96 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+
+#include "concurrent_map.h"
+#include "test_Unit.h"
+
+using namespace std;
+
+void TestConcurrentMapCountsFromManyThreads() {
+    ConcurrentMap<int, int> counters;
+    const int thread_count = 4;
+    const int key_count = 10'000;
+
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&counters] {
+            for (int key = 0; key < key_count; ++key) {
+                ++counters[key].ref_to_value;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQUAL(counters.Size(), static_cast<size_t>(key_count));
+    int total = 0;
+    counters.ForEach([&total](int, int value) {
+        total += value;
+    });
+    ASSERT_EQUAL(total, thread_count * key_count);
+    ASSERT_EQUAL(counters.Find(17).value_or(0), thread_count);
+    ASSERT(!counters.Find(key_count).has_value());
+}
+
+void TestConcurrentMapErase() {
+    ConcurrentMap<uint32_t, double> map(3);
+    for (uint32_t key = 0; key < 1'000; ++key) {
+        map[key].ref_to_value = key * 0.5;
+    }
+    for (uint32_t key = 0; key < 1'000; key += 2) {
+        map.Erase(key);
+    }
+    map.Erase(5'000);
+
+    const auto ordinary = map.BuildOrdinaryMap();
+    ASSERT_EQUAL(ordinary.size(), 500u);
+    for (uint32_t key = 0; key < 1'000; ++key) {
+        ASSERT_EQUAL(map.Find(key).has_value(), key % 2 == 1);
+    }
+    ASSERT_EQUAL(ordinary.at(999), 499.5);
+
+    // a throwing change leaves its shard readable
+    bool thrown = false;
+    try {
+        map.ForEach([](uint32_t key, double&) {
+            if (key == 999) {
+                throw runtime_error("stop"s);
+            }
+        });
+    } catch (const runtime_error&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL(map.Find(999).value_or(0.0), 499.5);
+}
+
+void TestConcurrentMapReadsDuringWrites() {
+    ConcurrentMap<int, long long> map;
+    atomic<bool> done = false;
+    thread writer([&map, &done] {
+        for (long long value = 1; value <= 200'000; ++value) {
+            map[value % 64].ref_to_value = value * 3;
+        }
+        done = true;
+    });
+
+    // every value ever written is divisible by 3, a torn read would show up here
+    bool consistent = true;
+    while (!done) {
+        for (int key = 0; key < 64; ++key) {
+            const auto value = map.Find(key);
+            consistent = consistent && (!value || *value % 3 == 0);
+        }
+    }
+    writer.join();
+    ASSERT(consistent);
+}
+
+void Test_ConcurrentMap() {
+    RUN_TEST(TestConcurrentMapCountsFromManyThreads);
+    RUN_TEST(TestConcurrentMapErase);
+    RUN_TEST(TestConcurrentMapReadsDuringWrites);
+}
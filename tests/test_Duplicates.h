@@ -0,0 +1,101 @@
+#pragma once
+
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "test_Unit.h"
+#include "thread_pool.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestRemoveDuplicates() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+
+    ASSERT_EQUAL(search_server.FindDuplicate(4).value_or(0), 2);
+    ASSERT_EQUAL(search_server.FindDuplicate(2).value_or(0), 3);
+    ASSERT(!search_server.FindDuplicate(8).has_value());
+    ASSERT_EQUAL(search_server.FindDuplicate("rat nasty and funny pet"s).value_or(0), 1);
+    ASSERT_EQUAL(search_server.FindDuplicate("rat with pet"s).value_or(0), 8);
+    ASSERT(!search_server.FindDuplicate("rat pet curly"s).has_value());
+    ASSERT(!search_server.FindDuplicate("rat pet unknown"s).has_value());
+
+    ostringstream output;
+    auto* const buffer = cout.rdbuf(output.rdbuf());
+    RemoveDuplicates(search_server);
+    cout.rdbuf(buffer);
+    ASSERT_EQUAL(output.str(), "Found duplicate document id 3\n"s
+                               "Found duplicate document id 4\n"s
+                               "Found duplicate document id 5\n"s
+                               "Found duplicate document id 7\n"s);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+    ASSERT(search_server.FindDuplicates().empty());
+
+    // a removed document leaves the index, a new copy finds the one left
+    search_server.RemoveDocument(2);
+    ASSERT(!search_server.FindDuplicate("curly hair funny pet"s).has_value());
+    search_server.AddDocuments({{10, "curly hair funny pet"s, DocumentStatus::ACTUAL, {1}},
+                                {11, "hair pet curly funny"s, DocumentStatus::BANNED, {2}}});
+    ASSERT_EQUAL(search_server.FindDuplicate(11).value_or(0), 10);
+    ASSERT_EQUAL(search_server.FindDuplicates(execution::par), vector<int>{11});
+}
+
+void TestFindDuplicatesMatchesWordSets() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 50, 5);
+    SearchServer search_server(dictionary[0]);
+    // few words from a small dictionary, so many documents share their sets of words
+    vector<string> texts;
+    for (int i = 0; i < 20'000; ++i) {
+        texts.push_back(GenerateQuery(generator, dictionary, 1 + i % 3));
+    }
+    vector<DocumentToAdd> batch;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        batch.push_back({static_cast<int>(i * 3 % texts.size()), texts[i], DocumentStatus::ACTUAL, {1}});
+    }
+    search_server.AddDocuments(execution::par, batch);
+    for (int document_id = 0; document_id < 20'000; document_id += 7) {
+        search_server.RemoveDocument(document_id);
+    }
+
+    const auto expected = [&search_server] {
+        map<set<string_view>, int> originals;
+        vector<int> duplicates;
+        for (const int document_id : search_server) {
+            set<string_view> words;
+            for (const auto& [word, freq] : search_server.GetWordFrequencies(document_id)) {
+                words.insert(word);
+            }
+            if (!originals.emplace(words, document_id).second) {
+                duplicates.push_back(document_id);
+            }
+        }
+        return duplicates;
+    }();
+    ASSERT(!expected.empty());
+    ASSERT_EQUAL(search_server.FindDuplicates(execution::seq), expected);
+
+    ThreadPoolOptions options;
+    options.thread_count = 4;
+    ThreadPool::ConfigureDefault(options);
+    ASSERT_EQUAL(search_server.FindDuplicates(execution::par), expected);
+    ThreadPool::ConfigureDefault({});
+}
+
+void Test_Duplicates() {
+    RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestFindDuplicatesMatchesWordSets);
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include "durable_search_server.h"
+#include "search_server.h"
+#include "test_Unit.h"
+#include "words_generator.h"
+#include "write_ahead_log.h"
+
+using namespace std;
+
+string MakeTestDirectory(mt19937& generator) {
+    const auto path = filesystem::temp_directory_path() / ("search_server_durable_"s + to_string(generator()));
+    filesystem::remove_all(path);
+    return path.string();
+}
+
+void TestDurableRestoresChanges() {
+    mt19937 generator;
+    const string directory = MakeTestDirectory(generator);
+    const auto dictionary = GenerateDictionary(generator, 200, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 300, 15);
+    const string stop_words = dictionary[0] + " "s + dictionary[1];
+
+    SearchServer expected(stop_words);
+    {
+        WriteAheadLogOptions options;
+        options.sync = false;
+        DurableSearchServer search_server(stop_words, directory, options);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            const auto status = static_cast<DocumentStatus>(i % 4);
+            const vector<int> ratings = {static_cast<int>(i % 7) - 3, static_cast<int>(i % 5)};
+            search_server.AddDocument(static_cast<int>(i), documents[i], status, ratings);
+            expected.AddDocument(static_cast<int>(i), documents[i], status, ratings);
+            if (i == documents.size() / 2) {
+                search_server.Checkpoint();
+            }
+            if (i % 10 == 9) {
+                search_server.RemoveDocument(static_cast<int>(i - 5));
+                expected.RemoveDocument(static_cast<int>(i - 5));
+            }
+        }
+
+        bool thrown = false;
+        try {
+            search_server.AddDocument(0, "funny pet"s, DocumentStatus::ACTUAL, {1});
+        } catch (const invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, "duplicate id must be rejected and not logged"s);
+
+        thrown = false;
+        try {
+            search_server.RemoveDocument(static_cast<int>(documents.size()));
+        } catch (const out_of_range&) {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, "unknown id must be rejected and not logged"s);
+    }
+
+    // a torn record at the end of the log is cut off
+    {
+        ofstream log((filesystem::path(directory) / "log"s).string(), ios::binary | ios::app);
+        log << "torn"s;
+    }
+
+    for (int restart = 0; restart < 2; ++restart) {
+        DurableSearchServer search_server(stop_words, directory);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), expected.GetDocumentCount());
+        for (int i = 0; i < 50; ++i) {
+            const string query = GenerateQuery(generator, dictionary, 5, 0.2);
+            AssertSameTop(expected.FindTopDocuments(query), search_server.FindTopDocuments(query));
+            AssertSameTop(expected.FindTopDocuments(query, DocumentStatus::BANNED),
+                          search_server.FindTopDocuments(query, DocumentStatus::BANNED));
+        }
+        const auto [words, status] = search_server.MatchDocument(documents[1], 1);
+        ASSERT(words == get<0>(expected.MatchDocument(documents[1], 1)));
+        // the next start reads the whole index from the snapshot
+        search_server.Checkpoint();
+    }
+    filesystem::remove_all(directory);
+}
+
+// Makes writes to regular files past size fail with EFBIG while it lives
+class FileSizeLimit {
+public:
+    explicit FileSizeLimit(rlim_t size) {
+        getrlimit(RLIMIT_FSIZE, &saved_limit_);
+        saved_handler_ = signal(SIGXFSZ, SIG_IGN);
+        rlimit limit = saved_limit_;
+        limit.rlim_cur = size;
+        setrlimit(RLIMIT_FSIZE, &limit);
+    }
+
+    ~FileSizeLimit() {
+        setrlimit(RLIMIT_FSIZE, &saved_limit_);
+        signal(SIGXFSZ, saved_handler_);
+    }
+
+private:
+    rlimit saved_limit_;
+    void (*saved_handler_)(int);
+};
+
+void TestDurableDropsChangesOfFailedLog() {
+    mt19937 generator;
+    for (const bool removing : {false, true}) {
+        const string directory = MakeTestDirectory(generator);
+        {
+            DurableSearchServer search_server(""s, directory);
+            search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+            bool thrown = false;
+            {
+                const FileSizeLimit limit(filesystem::file_size(filesystem::path(directory) / "log"s));
+                try {
+                    if (removing) {
+                        search_server.RemoveDocument(1);
+                    } else {
+                        search_server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, {1});
+                    }
+                } catch (const runtime_error&) {
+                    thrown = true;
+                }
+            }
+            ASSERT_HINT(thrown, "a change the log failed to write must be reported"s);
+            // readers see what the next start restores
+            ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+            ASSERT_EQUAL(search_server.FindTopDocuments("cat dog"s).size(), 1u);
+            ASSERT_EQUAL(search_server.FindTopDocuments("cat dog"s)[0].id, 1);
+        }
+        DurableSearchServer restarted(""s, directory);
+        ASSERT_EQUAL(restarted.GetDocumentCount(), 1);
+        ASSERT_EQUAL(restarted.FindTopDocuments("cat dog"s)[0].id, 1);
+        filesystem::remove_all(directory);
+    }
+}
+
+void TestWriteAheadLogGroupCommit() {
+    mt19937 generator;
+    const string directory = MakeTestDirectory(generator);
+    filesystem::create_directories(directory);
+    const string path = (filesystem::path(directory) / "log"s).string();
+
+    const int thread_count = 4;
+    const int records_per_thread = 50;
+    {
+        WriteAheadLogOptions options;
+        options.group_commit_delay = chrono::milliseconds(2);
+        options.max_group_size = thread_count;
+        WriteAheadLog log(path, 1, options);
+        vector<thread> writers;
+        for (int i = 0; i < thread_count; ++i) {
+            writers.emplace_back([&log, i]() {
+                for (int j = 0; j < records_per_thread; ++j) {
+                    log.WaitDurable(log.Append(to_string(i) + ":"s + to_string(j)));
+                }
+            });
+        }
+        for (thread& writer : writers) {
+            writer.join();
+        }
+        ASSERT_EQUAL(log.GetLastSequenceNumber(), static_cast<uint64_t>(thread_count * records_per_thread));
+        // writers waiting together share a commit
+        ASSERT(log.GetCommitCount() < static_cast<uint64_t>(thread_count * records_per_thread));
+    }
+
+    vector<int> next_record(thread_count, 0);
+    uint64_t previous_sequence_number = 0;
+    const uint64_t last = WriteAheadLog::Replay(path, [&](uint64_t sequence_number, string_view record) {
+        ASSERT_EQUAL(sequence_number, previous_sequence_number + 1);
+        previous_sequence_number = sequence_number;
+        const size_t colon = record.find(':');
+        const int writer = stoi(string(record.substr(0, colon)));
+        // records of one writer keep their order
+        ASSERT_EQUAL(stoi(string(record.substr(colon + 1))), next_record[writer]++);
+    });
+    ASSERT_EQUAL(last, static_cast<uint64_t>(thread_count * records_per_thread));
+    filesystem::remove_all(directory);
+}
+
+void TestWriteAheadLogTruncateKeepsUncoveredRecords() {
+    mt19937 generator;
+    const string directory = MakeTestDirectory(generator);
+    filesystem::create_directories(directory);
+    const string path = (filesystem::path(directory) / "log"s).string();
+
+    {
+        WriteAheadLog log(path, 1);
+        log.WaitDurable(log.Append("first"s));
+        log.Append("second"s);
+        log.Append("third"s);
+
+        const auto rejects = [&log](uint64_t covered_sequence_number) {
+            try {
+                log.Truncate(covered_sequence_number);
+            } catch (const invalid_argument&) {
+                return true;
+            }
+            return false;
+        };
+        ASSERT_HINT(rejects(4), "a record never appended can't be covered"s);
+        // the snapshot holds the first two records, the third is only pending
+        log.Truncate(2);
+        log.WaitDurable(2);
+        log.WaitDurable(log.Append("fourth"s));
+        ASSERT_HINT(rejects(3), "records written after the snapshot must not be lost"s);
+    }
+
+    vector<pair<uint64_t, string>> records;
+    WriteAheadLog::Replay(path, [&records](uint64_t sequence_number, string_view record) {
+        records.emplace_back(sequence_number, string(record));
+    });
+    ASSERT(records == (vector<pair<uint64_t, string>>{{3, "third"s}, {4, "fourth"s}}));
+    filesystem::remove_all(directory);
+}
+
+void Test_DurableSearchServer() {
+    RUN_TEST(TestDurableRestoresChanges);
+    RUN_TEST(TestDurableDropsChangesOfFailedLog);
+    RUN_TEST(TestWriteAheadLogGroupCommit);
+    RUN_TEST(TestWriteAheadLogTruncateKeepsUncoveredRecords);
+}
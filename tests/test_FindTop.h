@@ -7,6 +7,7 @@
 
 #include "process_queries.h"
 #include "search_server.h"
+#include "test_Unit.h"
 #include "words_generator.h"
 
 
@@ -75,6 +76,12 @@ void Test_FindTop() {
 
         const auto queries = GenerateQueries(generator, dictionary, 100, 70);
 
+        // the parallel search splits these documents between several tasks
+        for (const string& query : queries) {
+            AssertSameTop(search_server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, 20),
+                          search_server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, 20));
+        }
+
         TEST_FindTop(seq);
         TEST_FindTop(par);
     }
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdio>
+#include <fstream>
+
+#include "compressed_postings.h"
+#include "frozen_search_server.h"
+#include "search_server.h"
+#include "test_Unit.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestFrozenMatchesSearchServer() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 2'000, 20);
+
+    SearchServer search_server(dictionary[0] + " "s + dictionary[1]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i * 3), documents[i],
+                                  static_cast<DocumentStatus>(i % 4),
+                                  {uniform_int_distribution(-10, 10)(generator)});
+    }
+    const FrozenSearchServer frozen(search_server);
+    ASSERT_EQUAL(frozen.GetDocumentCount(), search_server.GetDocumentCount());
+
+    size_t posting_count = 0;
+    for (const int document_id : search_server) {
+        posting_count += search_server.GetWordFrequencies(document_id).size();
+    }
+    // a document id and a double per posting before the compression
+    ASSERT(frozen.GetPostingsByteSize() * 4 < posting_count * (sizeof(uint32_t) + sizeof(double)));
+
+    const auto even_ids = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+    for (int i = 0; i < 100; ++i) {
+        const string query = GenerateQuery(generator, dictionary, 6, 0.2);
+        AssertSameTop(search_server.FindTopDocuments(query), frozen.FindTopDocuments(query));
+        AssertSameTop(search_server.FindTopDocuments(execution::par, query, DocumentStatus::BANNED),
+                      frozen.FindTopDocuments(execution::par, query, DocumentStatus::BANNED));
+        AssertSameTop(search_server.FindTopDocuments(execution::seq, query, even_ids),
+                      frozen.FindTopDocuments(execution::par, query, even_ids));
+
+        const int document_id = 3 * uniform_int_distribution(0, 1'999)(generator);
+        const auto [words, status] = search_server.MatchDocument(query, document_id);
+        const auto [frozen_words, frozen_status] = frozen.MatchDocument(query, document_id);
+        ASSERT(words == frozen_words);
+        ASSERT(status == frozen_status);
+        const auto [par_words, par_status] = frozen.MatchDocument(execution::par, query, document_id);
+        ASSERT(words == par_words);
+    }
+}
+
+void TestCompressedPostingsAdvance() {
+    mt19937 generator;
+    vector<vector<CompressedPostings::Posting>> lists(3);
+    uint32_t document = 0;
+    for (int i = 0; i < 1'000; ++i) {
+        document += uniform_int_distribution<uint32_t>(1, i % 100 == 0 ? 100'000 : 20)(generator);
+        lists[1].push_back({document, uniform_int_distribution<uint32_t>(1, 300)(generator)});
+    }
+    lists[2].push_back({0, 1});
+
+    CompressedPostings postings;
+    for (const auto& list : lists) {
+        postings.AddList(list);
+    }
+    ASSERT_EQUAL(postings.GetListCount(), 3u);
+    ASSERT(postings.Open(0).IsEnd());
+    ASSERT_EQUAL(postings.GetPostingCount(1), 1'000u);
+
+    auto cursor = postings.Open(1);
+    for (const auto& posting : lists[1]) {
+        ASSERT_EQUAL(cursor.GetDocument(), posting.document);
+        ASSERT_EQUAL(cursor.GetCount(), posting.count);
+        cursor.Next();
+    }
+    ASSERT(cursor.IsEnd());
+
+    for (int i = 0; i < 1'000; ++i) {
+        const uint32_t target = uniform_int_distribution<uint32_t>(0, document + 1)(generator);
+        const auto expected = lower_bound(lists[1].begin(), lists[1].end(), target,
+                                          [](const CompressedPostings::Posting& posting, uint32_t value) {
+                                              return posting.document < value;
+                                          });
+        auto advanced = postings.Open(1);
+        advanced.Advance(target / 2);
+        advanced.Advance(target);
+        ASSERT_EQUAL(advanced.IsEnd(), expected == lists[1].end());
+        if (!advanced.IsEnd()) {
+            ASSERT_EQUAL(advanced.GetDocument(), expected->document);
+            ASSERT_EQUAL(advanced.GetCount(), expected->count);
+        }
+    }
+
+    auto single = postings.Open(2);
+    ASSERT_EQUAL(single.GetDocument(), 0u);
+    single.Advance(1);
+    ASSERT(single.IsEnd());
+}
+
+void TestFrozenRejectsInvalidQueries() {
+    SearchServer search_server("in the"s);
+    search_server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    const FrozenSearchServer frozen(search_server);
+
+    ASSERT(frozen.FindTopDocuments("in"s).empty());
+    ASSERT_EQUAL(frozen.FindTopDocuments("cat -dog"s).size(), 1u);
+    ASSERT(frozen.FindTopDocuments("cat -city"s).empty());
+
+    bool thrown = false;
+    try {
+        frozen.FindTopDocuments("cat --city"s);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "double minus must be rejected"s);
+
+    thrown = false;
+    try {
+        frozen.MatchDocument("cat"s, 2);
+    } catch (const out_of_range&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "unknown document must be rejected"s);
+}
+
+void TestFrozenSaveOpen() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 1'000, 20);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i * 5), documents[i],
+                                  static_cast<DocumentStatus>(i % 4),
+                                  {uniform_int_distribution(-10, 10)(generator)});
+    }
+    const FrozenSearchServer frozen(search_server);
+    const string path = "/tmp/search_server_test_"s + to_string(generator()) + ".idx"s;
+    frozen.Save(path);
+
+    {
+        const FrozenSearchServer opened = FrozenSearchServer::Open(path, FrozenSearchServer::FileCheck::FULL);
+        const FrozenSearchServer trusted = FrozenSearchServer::Open(path);
+        ASSERT_EQUAL(opened.GetDocumentCount(), frozen.GetDocumentCount());
+        ASSERT(equal(opened.begin(), opened.end(), frozen.begin(), frozen.end()));
+        for (int i = 0; i < 50; ++i) {
+            const string query = GenerateQuery(generator, dictionary, 6, 0.2);
+            AssertSameTop(frozen.FindTopDocuments(query), opened.FindTopDocuments(query));
+            AssertSameTop(frozen.FindTopDocuments(execution::par, query, DocumentStatus::BANNED),
+                          trusted.FindTopDocuments(execution::par, query, DocumentStatus::BANNED));
+            ASSERT(get<0>(frozen.MatchDocument(query, 5 * i)) == get<0>(opened.MatchDocument(query, 5 * i)));
+        }
+    }
+
+    const auto rejects = [&path]() {
+        try {
+            FrozenSearchServer::Open(path, FrozenSearchServer::FileCheck::FULL);
+        } catch (const runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+
+    // one flipped byte in the postings
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        file.seekg(0, ios::end);
+        const auto middle = file.tellg() / 2;
+        file.seekg(middle);
+        const char byte = static_cast<char>(file.get());
+        file.seekp(middle);
+        file.put(static_cast<char>(byte ^ 0x10));
+    }
+    ASSERT_HINT(rejects(), "corrupted file must be rejected"s);
+
+    // damaged skip entries and posting lists pass the header check but not the posting check;
+    // the header holds {offset, count} of every section from byte 32, the blocks are section 4
+    // and the list offsets section 5
+    const auto rejects_unchecked = [&path, &frozen](size_t section, size_t field_offset, uint64_t value) {
+        frozen.Save(path);
+        {
+            fstream file(path, ios::in | ios::out | ios::binary);
+            uint64_t section_offset = 0;
+            file.seekg(static_cast<streamoff>(32 + section * 16));
+            file.read(reinterpret_cast<char*>(&section_offset), sizeof(section_offset));
+            file.seekp(static_cast<streamoff>(section_offset + field_offset));
+            file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        try {
+            FrozenSearchServer::Open(path, FrozenSearchServer::FileCheck::POSTINGS);
+        } catch (const runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    ASSERT_HINT(rejects_unchecked(4, 8, 1ULL << 40), "block byte offset out of bounds must be rejected"s);
+    ASSERT_HINT(rejects_unchecked(4, 0, 1'000'000), "document out of bounds must be rejected"s);
+    ASSERT_HINT(rejects_unchecked(4, 16 + 8, 1), "overlapping blocks must be rejected"s);
+    ASSERT_HINT(rejects_unchecked(5, 16 + 8, 1ULL << 40), "list offset out of bounds must be rejected"s);
+    ASSERT_HINT(rejects_unchecked(5, 16, 1'000'000), "posting count out of bounds must be rejected"s);
+
+    frozen.Save(path);
+    {
+        ofstream file(path, ios::binary | ios::app);
+        file.put('\0');
+    }
+    ASSERT_HINT(rejects(), "file of a wrong size must be rejected"s);
+
+    {
+        ofstream file(path, ios::binary | ios::trunc);
+        file << "not an index"s;
+    }
+    ASSERT_HINT(rejects(), "foreign file must be rejected"s);
+
+    remove(path.c_str());
+    ASSERT_HINT(rejects(), "missing file must be rejected"s);
+}
+
+void Test_FrozenSearchServer() {
+    RUN_TEST(TestFrozenMatchesSearchServer);
+    RUN_TEST(TestCompressedPostingsAdvance);
+    RUN_TEST(TestFrozenRejectsInvalidQueries);
+    RUN_TEST(TestFrozenSaveOpen);
+}
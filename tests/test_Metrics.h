@@ -0,0 +1,136 @@
+#pragma once
+
+#include <sstream>
+#include <thread>
+
+#include "latency_histogram.h"
+#include "metrics.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "test_Unit.h"
+
+using namespace std;
+
+void TestLatencyHistogramPercentiles() {
+    LatencyHistogram histogram;
+    ASSERT_EQUAL(histogram.GetPercentile(0.5), 0u);
+    for (uint64_t value = 1; value <= 100'000; ++value) {
+        histogram.Add(value);
+    }
+    ASSERT_EQUAL(histogram.GetCount(), 100'000u);
+    // a bucket spans a quarter of its power of two
+    for (const double fraction : {0.5, 0.9, 0.99, 0.999}) {
+        const double expected = fraction * 100'000;
+        const auto value = static_cast<double>(histogram.GetPercentile(fraction));
+        ASSERT_HINT(value >= expected * 0.8 && value <= expected * 1.2, to_string(fraction));
+    }
+    ASSERT(histogram.GetMax() >= 80'000 && histogram.GetMax() <= 120'000);
+    ASSERT_EQUAL(LatencyHistogram::GetBucketValue(LatencyHistogram::GetBucket(3)), 3u);
+
+    LatencyHistogram earlier = histogram;
+    histogram.Add(1'000'000, 5);
+    histogram.Subtract(earlier);
+    ASSERT_EQUAL(histogram.GetCount(), 5u);
+    ASSERT(histogram.GetPercentile(0.5) >= 800'000 && histogram.GetPercentile(0.5) <= 1'200'000);
+}
+
+void TestMetricsFollowServerStages() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+
+    Metrics::SetEnabled(false);
+    Metrics::Reset();
+    search_server.FindTopDocuments("curly cat"s);
+    ASSERT_EQUAL(Metrics::GetSnapshot()[MetricsCounter::QUERIES], 0u);
+
+    Metrics::SetEnabled(true);
+    search_server.AddDocument(2, "nasty dog with big eyes"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocuments({{3, "funny pet"s, DocumentStatus::ACTUAL, {1}},
+                                {4, "curly dog"s, DocumentStatus::BANNED, {2}}});
+    search_server.FindTopDocuments("curly -dog"s);
+    search_server.FindTopDocuments(execution::par, "curly dog"s);
+    search_server.FindTopDocuments(WandPolicy{}, "nasty cat"s);
+    search_server.MatchDocument("curly dog"s, 4);
+    search_server.MatchDocument(execution::par, "curly dog"s, 4);
+    search_server.RemoveDocument(3);
+    // a thread that is gone by the time of the snapshot still counts
+    thread([&search_server] {
+        search_server.FindTopDocuments("funny"s);
+    }).join();
+
+    const MetricsSnapshot snapshot = Metrics::GetSnapshot();
+    Metrics::SetEnabled(false);
+    ASSERT_EQUAL(snapshot[MetricsCounter::QUERIES], 4u);
+    ASSERT_EQUAL(snapshot[MetricsCounter::MATCHES], 2u);
+    ASSERT_EQUAL(snapshot[MetricsCounter::DOCUMENTS_ADDED], 3u);
+    ASSERT_EQUAL(snapshot[MetricsCounter::DOCUMENTS_REMOVED], 1u);
+    ASSERT_EQUAL(snapshot[MetricsStage::PARSE].GetCount(), 6u);
+    ASSERT_EQUAL(snapshot[MetricsStage::ADD_DOCUMENT].GetCount(), 1u);
+    ASSERT_EQUAL(snapshot[MetricsStage::ADD_DOCUMENTS].GetCount(), 1u);
+    ASSERT_EQUAL(snapshot[MetricsStage::REMOVE_DOCUMENT].GetCount(), 1u);
+    ASSERT_EQUAL(snapshot[MetricsStage::MATCH_DOCUMENT].GetCount(), 2u);
+    ASSERT_EQUAL(snapshot[MetricsStage::MINUS_FILTER].GetCount(), 3u);
+    ASSERT_EQUAL(snapshot[MetricsStage::POSTING_SCAN].GetCount(), 4u);
+    ASSERT_EQUAL(snapshot[MetricsStage::TOP_K].GetCount(), 3u);
+
+    ostringstream out;
+    out << snapshot;
+    ASSERT(out.str().find("posting_scan: count = "s) != string::npos);
+    ASSERT(out.str().find("documents_removed: 1"s) != string::npos);
+
+    Metrics::Reset();
+    ASSERT_EQUAL(Metrics::GetSnapshot()[MetricsCounter::QUERIES], 0u);
+    ASSERT_EQUAL(Metrics::GetSnapshot()[MetricsStage::PARSE].GetCount(), 0u);
+}
+
+void TestMetricsCountParallelQueryOnce() {
+    // enough documents for the parallel search to split them into several tasks
+    SearchServer search_server("and"s);
+    for (int id = 0; id < 20'000; ++id) {
+        search_server.AddDocument(id, id % 2 ? "curly cat"s : "funny dog"s, DocumentStatus::ACTUAL, {1});
+    }
+
+    ThreadPoolOptions pool_options;
+    pool_options.thread_count = 4;
+    ThreadPool::ConfigureDefault(pool_options);
+    Metrics::Reset();
+    Metrics::SetEnabled(true);
+    search_server.FindTopDocuments(execution::par, "curly -dog"s);
+    search_server.FindTopDocuments(execution::par, "funny cat"s);
+    Metrics::SetEnabled(false);
+    ThreadPool::ConfigureDefault({});
+
+    const MetricsSnapshot snapshot = Metrics::GetSnapshot();
+    Metrics::Reset();
+    ASSERT_EQUAL(snapshot[MetricsCounter::QUERIES], 2u);
+    ASSERT_EQUAL(snapshot[MetricsStage::MINUS_FILTER].GetCount(), 2u);
+    ASSERT_EQUAL(snapshot[MetricsStage::POSTING_SCAN].GetCount(), 2u);
+    ASSERT_EQUAL(snapshot[MetricsStage::TOP_K].GetCount(), 2u);
+}
+
+void TestMetricsCountShardedQueryOnce() {
+    ShardedSearchServer sharded("and"s, 4);
+    for (int id = 0; id < 40; ++id) {
+        sharded.AddDocument(id, id % 2 ? "curly cat"s : "funny dog"s, DocumentStatus::ACTUAL, {1});
+    }
+
+    Metrics::Reset();
+    Metrics::SetEnabled(true);
+    sharded.FindTopDocuments("curly -dog"s);
+    Metrics::SetEnabled(false);
+
+    const MetricsSnapshot snapshot = Metrics::GetSnapshot();
+    Metrics::Reset();
+    ASSERT_EQUAL(snapshot[MetricsCounter::QUERIES], 1u);
+    ASSERT_EQUAL(snapshot[MetricsStage::PARSE].GetCount(), 1u);
+    ASSERT_EQUAL(snapshot[MetricsStage::MINUS_FILTER].GetCount(), 1u);
+    ASSERT_EQUAL(snapshot[MetricsStage::POSTING_SCAN].GetCount(), 1u);
+    ASSERT_EQUAL(snapshot[MetricsStage::TOP_K].GetCount(), 1u);
+}
+
+void Test_Metrics() {
+    RUN_TEST(TestLatencyHistogramPercentiles);
+    RUN_TEST(TestMetricsFollowServerStages);
+    RUN_TEST(TestMetricsCountParallelQueryOnce);
+    RUN_TEST(TestMetricsCountShardedQueryOnce);
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+#include "near_duplicates.h"
+#include "search_server.h"
+#include "test_Unit.h"
+#include "thread_pool.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestNearDuplicateClusters() {
+    SearchServer search_server("and with"s);
+    const string base = "a b c d e f g h i j k l m n o p q r s t"s;
+    search_server.AddDocument(1, base, DocumentStatus::ACTUAL, {1});
+    // one word replaced: 19 common of 21
+    search_server.AddDocument(2, "a b c d e f g h i j k l m n o p q r s u"s, DocumentStatus::ACTUAL, {1});
+    // half of the words replaced
+    search_server.AddDocument(3, "a b c d e f g h i j v w x y z aa bb cc dd ee"s, DocumentStatus::ACTUAL, {1});
+    // the same words in another order with a stop word, similar to 2 only through 1
+    search_server.AddDocument(4, "t s r q p o n m l k j i h g f e d c b a and"s, DocumentStatus::BANNED, {1});
+    search_server.AddDocument(5, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(6, "curly dog"s, DocumentStatus::ACTUAL, {1});
+
+    ASSERT_EQUAL(NearDuplicateFinder::ComputeSimilarity(search_server, 1, 4), 1.0);
+    ASSERT_EQUAL(NearDuplicateFinder::ComputeSimilarity(search_server, 1, 2), 19.0 / 21.0);
+    ASSERT_EQUAL(NearDuplicateFinder::ComputeSimilarity(search_server, 5, 6), 1.0 / 3.0);
+
+    const NearDuplicateFinder finder;
+    const vector<vector<int>> expected = {{1, 2, 4}};
+    ASSERT_EQUAL(finder.FindClusters(search_server), expected);
+    ASSERT_EQUAL(finder.FindClusters(execution::par, search_server), expected);
+
+    // single rows make pairs this far apart candidates too
+    NearDuplicateOptions options;
+    options.jaccard_threshold = 0.3;
+    options.band_count = 50;
+    options.rows_per_band = 1;
+    ASSERT_EQUAL(NearDuplicateFinder(options).FindClusters(search_server),
+                 (vector<vector<int>>{{1, 2, 3, 4}, {5, 6}}));
+
+    search_server.RemoveDocument(1);
+    ASSERT_EQUAL(finder.FindClusters(search_server), (vector<vector<int>>{{2, 4}}));
+
+    options.band_count = 0;
+    bool thrown = false;
+    try {
+        NearDuplicateFinder invalid(options);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestNearDuplicateChains() {
+    SearchServer search_server(""s);
+    // every next document replaces two words of the previous one: 18 common of 22 with it,
+    // 16 of 24 with the one before
+    search_server.AddDocument(1, "a b c d e f g h i j k l m n o p q r s t"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "a b c d e f g h i j k l m n o p q r u v"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "a b c d e f g h i j k l m n o p w x u v"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(4, "a b c d e f g h i j k l m n y z w x u v"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(NearDuplicateFinder::ComputeSimilarity(search_server, 1, 3) < 0.8);
+    ASSERT(NearDuplicateFinder::ComputeSimilarity(search_server, 2, 3) >= 0.8);
+
+    // some of the single-row bands puts all four into one bucket, where 3 is similar to 2 only
+    NearDuplicateOptions options;
+    options.band_count = 50;
+    options.rows_per_band = 1;
+    const vector<vector<int>> expected = {{1, 2, 3, 4}};
+    ASSERT_EQUAL(NearDuplicateFinder(options).FindClusters(search_server), expected);
+    ASSERT_EQUAL(NearDuplicateFinder().FindClusters(execution::par, search_server), expected);
+}
+
+// Clusters of the pairs at the threshold, every pair compared
+vector<vector<int>> FindNearDuplicatesPairwise(const SearchServer& search_server, double threshold) {
+    const vector<int> ids(search_server.begin(), search_server.end());
+    vector<size_t> parents(ids.size());
+    iota(parents.begin(), parents.end(), 0);
+    const auto find = [&parents](size_t i) {
+        while (parents[i] != i) {
+            i = parents[i];
+        }
+        return i;
+    };
+    for (size_t i = 0; i < ids.size(); ++i) {
+        for (size_t j = i + 1; j < ids.size(); ++j) {
+            if (NearDuplicateFinder::ComputeSimilarity(search_server, ids[i], ids[j]) >= threshold) {
+                parents[find(j)] = find(i);
+            }
+        }
+    }
+    vector<vector<int>> clustered(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        clustered[find(i)].push_back(ids[i]);
+    }
+    vector<vector<int>> clusters;
+    for (auto& cluster : clustered) {
+        if (cluster.size() > 1) {
+            clusters.push_back(move(cluster));
+        }
+    }
+    sort(clusters.begin(), clusters.end());
+    return clusters;
+}
+
+// Generated documents followed by shuffled copies of them with up to a quarter of the words replaced
+vector<string> GenerateNearCopies(mt19937& generator, const vector<string>& dictionary,
+                                  size_t original_count, size_t copy_count, int word_count) {
+    vector<string> texts;
+    vector<vector<string>> originals;
+    for (size_t i = 0; i < original_count; ++i) {
+        vector<string> words;
+        for (int j = 0; j < word_count; ++j) {
+            words.push_back(dictionary[uniform_int_distribution<size_t>(1, dictionary.size() - 1)(generator)]);
+        }
+        originals.push_back(words);
+    }
+    for (size_t i = 0; i < original_count + copy_count; ++i) {
+        vector<string> words = originals[i % original_count];
+        if (i >= original_count) {
+            const int changes = uniform_int_distribution(0, word_count / 4)(generator);
+            for (int change = 0; change < changes; ++change) {
+                words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] =
+                        dictionary[uniform_int_distribution<size_t>(1, dictionary.size() - 1)(generator)];
+            }
+            shuffle(words.begin(), words.end(), generator);
+        }
+        string text;
+        for (const string& word : words) {
+            text += text.empty() ? ""s : " "s;
+            text += word;
+        }
+        texts.push_back(text);
+    }
+    return texts;
+}
+
+void TestNearDuplicatesMatchPairwiseSearch() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 5'000, 8);
+    const auto texts = GenerateNearCopies(generator, dictionary, 600, 600, 30);
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1});
+    }
+
+    for (const double threshold : {0.6, 0.8}) {
+        // shorter bands keep the pairs near the lower threshold from being missed
+        NearDuplicateOptions options;
+        options.jaccard_threshold = threshold;
+        options.band_count = 30;
+        options.rows_per_band = 2;
+        const NearDuplicateFinder finder(options);
+        const auto expected = FindNearDuplicatesPairwise(search_server, threshold);
+        ASSERT(!expected.empty());
+        ASSERT_EQUAL(finder.FindClusters(search_server), expected);
+
+        ThreadPoolOptions pool_options;
+        pool_options.thread_count = 4;
+        ThreadPool::ConfigureDefault(pool_options);
+        ASSERT_EQUAL(finder.FindClusters(execution::par, search_server), expected);
+        ThreadPool::ConfigureDefault({});
+    }
+}
+
+void TestNearDuplicatesCompareWholeBucket() {
+    // x, z, y in bucket order: x is similar to both, z and y are not similar to each other
+    SearchServer search_server(""s);
+    const string common = "a b c d e f g h i j k l m n o p q r"s;
+    search_server.AddDocument(1, common + " s t"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, common + " s"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, common + " t"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(NearDuplicateFinder::ComputeSimilarity(search_server, 1, 2), 0.95);
+    ASSERT_EQUAL(NearDuplicateFinder::ComputeSimilarity(search_server, 1, 3), 0.95);
+    ASSERT_EQUAL(NearDuplicateFinder::ComputeSimilarity(search_server, 2, 3), 0.9);
+
+    // a single one-row band puts all three into one bucket unless the minimum of x is s or t;
+    // then y has to be compared with x, not only with z that joined x before it
+    NearDuplicateOptions options;
+    options.jaccard_threshold = 0.92;
+    options.band_count = 1;
+    options.rows_per_band = 1;
+    int whole_clusters = 0;
+    for (uint64_t seed = 0; seed < 20; ++seed) {
+        options.seed = seed;
+        const auto clusters = NearDuplicateFinder(options).FindClusters(search_server);
+        ASSERT(clusters == (vector<vector<int>>{{1, 2, 3}}) || clusters == (vector<vector<int>>{{1, 2}})
+               || clusters == (vector<vector<int>>{{1, 3}}));
+        whole_clusters += clusters.front().size() == 3 ? 1 : 0;
+    }
+    ASSERT_HINT(whole_clusters >= 12, "y must join x through the bucket they share with z"s);
+}
+
+void TestNearDuplicateCopies() {
+    // every band puts all the copies into one bucket, and all the stop-word documents into another
+    SearchServer search_server("and with"s);
+    vector<int> copies;
+    vector<int> stop_words;
+    for (int id = 0; id < 6'000; ++id) {
+        if (id % 2 == 0) {
+            search_server.AddDocument(id, "curly cat with fancy collar"s, DocumentStatus::ACTUAL, {1});
+            copies.push_back(id);
+        } else {
+            search_server.AddDocument(id, "and with"s, DocumentStatus::ACTUAL, {1});
+            stop_words.push_back(id);
+        }
+    }
+
+    const NearDuplicateFinder finder;
+    const vector<vector<int>> expected = {copies, stop_words};
+    ASSERT_EQUAL(finder.FindClusters(search_server), expected);
+    ASSERT_EQUAL(finder.FindClusters(execution::par, search_server), expected);
+}
+
+void Test_NearDuplicates() {
+    RUN_TEST(TestNearDuplicateClusters);
+    RUN_TEST(TestNearDuplicateChains);
+    RUN_TEST(TestNearDuplicateCopies);
+    RUN_TEST(TestNearDuplicatesCompareWholeBucket);
+    RUN_TEST(TestNearDuplicatesMatchPairwiseSearch);
+}
@@ -10,6 +10,7 @@
 
 #include "process_queries.h"
 #include "search_server.h"
+#include "test_Unit.h"
 
 #include "search_server.h"
 
@@ -76,6 +77,55 @@ void Test_ProcessQueries() {
     TEST_RmDoc(ProcessQueries);
 }
 
+void TestProcessQueriesFlat() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 3'000, 10);
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 10)});
+    }
+    // some queries find nothing, their tops leave gaps to close
+    auto queries = GenerateQueries(generator, dictionary, 500, 4);
+    queries.push_back("unknownword"s);
+    queries.insert(queries.begin(), dictionary[0]);
+
+    const auto expected = ProcessQueries(search_server, queries);
+    const QueryResults results = ProcessQueriesFlat(search_server, queries);
+    ASSERT_EQUAL(results.GetQueryCount(), queries.size());
+    vector<Document> expected_joined;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        AssertSameTop(expected[i], vector<Document>(results[i].begin(), results[i].end()));
+        expected_joined.insert(expected_joined.end(), expected[i].begin(), expected[i].end());
+    }
+    AssertSameTop(expected_joined, ProcessQueriesJoined(search_server, queries));
+
+    vector<Document> streamed;
+    size_t last_query = 0;
+    ProcessQueriesStreamed(search_server, queries, [&](size_t query, const Document& document) {
+        ASSERT(query >= last_query);
+        last_query = query;
+        streamed.push_back(document);
+    });
+    AssertSameTop(expected_joined, streamed);
+
+    QueryResults reused;
+    bool thrown = false;
+    try {
+        ProcessQueriesFlat(search_server, queries, 2, 1, reused);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "reversed range must be rejected"s);
+    thrown = false;
+    try {
+        ProcessQueriesFlat(search_server, queries, 0, queries.size() + 1, reused);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "range past the queries must be rejected"s);
+}
+
 void Test_ProcessQueriesJoined(){
     SearchServer search_server("and with"s);
 
@@ -102,6 +152,10 @@ void Test_ProcessQueriesJoined(){
     }
 }
 
+void Test_ProcessQueriesFlat() {
+    RUN_TEST(TestProcessQueriesFlat);
+}
+
 
 template <typename ExecutionPolicy>
 void Test(string_view mark, SearchServer search_server, ExecutionPolicy&& policy) {
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+#include "request_queue.h"
+#include "search_server.h"
+#include "test_Unit.h"
+
+using namespace std;
+
+void TestRequestQueueCountsSearches() {
+    SearchServer search_server("and in at"s);
+    search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    RequestQueue request_queue(search_server);
+
+    ASSERT(request_queue.AddFindRequest("empty request"s).empty());
+    ASSERT_EQUAL(request_queue.AddFindRequest("curly dog"s).size(), 2u);
+    ASSERT(request_queue.AddFindRequest("cat"s, DocumentStatus::BANNED).empty());
+    ASSERT_EQUAL(request_queue.AddFindRequest("curly"s, [](int document_id, DocumentStatus, int) {
+        return document_id == 1;
+    }).size(), 1u);
+
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 2);
+    const RequestStats stats = request_queue.GetStats();
+    ASSERT_EQUAL(stats.requests, 4u);
+    ASSERT_EQUAL(stats.no_result_rate, 0.5);
+}
+
+void TestRequestQueueWindowSlides() {
+    SearchServer search_server(""s);
+    RequestQueue request_queue(search_server, 10s);
+    const RequestQueue::Clock::time_point start(1'000s);
+
+    request_queue.Record(start, 1ms, 0);
+    request_queue.Record(start + 9s, 1ms, 3);
+    ASSERT_EQUAL(request_queue.GetStats(start + 9s).requests, 2u);
+    ASSERT_EQUAL(request_queue.GetStats(start + 9s).queries_per_second, 0.2);
+    ASSERT_EQUAL(request_queue.GetStats(start + 9s).no_result_requests, 1u);
+
+    const RequestStats later = request_queue.GetStats(start + 10s);
+    ASSERT_EQUAL(later.requests, 1u);
+    ASSERT_EQUAL(later.no_result_requests, 0u);
+
+    // the second 1011 takes the bucket of the second 1000, late records of it are dropped
+    request_queue.Record(start + 11s, 1ms, 0);
+    request_queue.Record(start, 1ms, 0);
+    ASSERT_EQUAL(request_queue.GetStats(start + 11s).requests, 2u);
+    ASSERT_EQUAL(request_queue.GetStats(start + 11s).no_result_requests, 1u);
+    ASSERT_EQUAL(request_queue.GetStats(start + 30s).requests, 0u);
+}
+
+void TestRequestQueuePercentiles() {
+    SearchServer search_server(""s);
+    RequestQueue request_queue(search_server);
+    const RequestQueue::Clock::time_point now(5'000s);
+    for (int latency = 1; latency <= 10'000; ++latency) {
+        request_queue.Record(now, chrono::microseconds(latency), 1);
+    }
+    const RequestStats stats = request_queue.GetStats(now);
+    // a bucket spans a quarter of its power of two
+    const auto near = [](chrono::microseconds value, double expected) {
+        return value.count() >= expected * 0.8 && value.count() <= expected * 1.2;
+    };
+    ASSERT_HINT(near(stats.p50, 5'000), to_string(stats.p50.count()));
+    ASSERT_HINT(near(stats.p99, 9'900), to_string(stats.p99.count()));
+    ASSERT_HINT(near(stats.p999, 9'990), to_string(stats.p999.count()));
+}
+
+void TestRequestQueueFromManyThreads() {
+    SearchServer search_server(""s);
+    RequestQueue request_queue(search_server, 5s);
+    const RequestQueue::Clock::time_point start(100s);
+
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&request_queue, start, i] {
+            // every thread moves through the seconds, so buckets get claimed concurrently
+            for (int j = 0; j < 20'000; ++j) {
+                request_queue.Record(start + chrono::seconds(j / 1'000), 10us, (i + j) % 2);
+            }
+        });
+    }
+    for (thread& thread : threads) {
+        thread.join();
+    }
+    const RequestStats stats = request_queue.GetStats(start + 19s);
+    ASSERT_EQUAL(stats.requests, 4u * 5'000);
+    ASSERT_EQUAL(stats.no_result_requests, 2u * 5'000);
+}
+
+void Test_RequestQueue() {
+    RUN_TEST(TestRequestQueueCountsSearches);
+    RUN_TEST(TestRequestQueueWindowSlides);
+    RUN_TEST(TestRequestQueuePercentiles);
+    RUN_TEST(TestRequestQueueFromManyThreads);
+}
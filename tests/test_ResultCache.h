@@ -0,0 +1,97 @@
+#pragma once
+
+#include <random>
+
+#include "process_queries.h"
+#include "search_server.h"
+#include "test_Unit.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestResultCacheFollowsChanges() {
+    SearchServer search_server("and with"s);
+    search_server.SetResultCacheCapacity(100);
+    search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "nasty dog with big eyes"s, DocumentStatus::BANNED, {2});
+
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly cat"s).size(), 1u);
+    // the same parsed query: words are sorted and deduplicated, stop words dropped
+    ASSERT_EQUAL(search_server.FindTopDocuments("cat and curly cat"s).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "curly cat"s).size(), 1u);
+    ASSERT_EQUAL(search_server.GetResultCacheStats().hits, 2u);
+    ASSERT_EQUAL(search_server.GetResultCacheStats().misses, 1u);
+
+    // the status and the number of results are parts of the key
+    ASSERT(search_server.FindTopDocuments("curly cat"s, DocumentStatus::BANNED).empty());
+    ASSERT(search_server.FindTopDocuments(execution::seq, "curly cat"s, DocumentStatus::ACTUAL, 0).empty());
+    ASSERT_EQUAL(search_server.GetResultCacheStats().misses, 3u);
+
+    search_server.AddDocument(3, "curly dog"s, DocumentStatus::ACTUAL, {3});
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly cat"s).size(), 2u);
+    search_server.RemoveDocument(1);
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly cat"s).size(), 1u);
+    search_server.AddDocuments({{4, "big cat"s, DocumentStatus::ACTUAL, {4}}});
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly cat"s).size(), 2u);
+    ASSERT_EQUAL(search_server.GetResultCacheStats().hits, 2u);
+
+    // a copy starts with an empty cache of its own
+    const SearchServer copy = search_server;
+    ASSERT_EQUAL(copy.FindTopDocuments("curly cat"s).size(), 2u);
+    ASSERT_EQUAL(copy.GetResultCacheStats().misses, 1u);
+
+    search_server.SetResultCacheCapacity(0);
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly cat"s).size(), 2u);
+    ASSERT_EQUAL(search_server.GetResultCacheStats().misses, 0u);
+}
+
+void TestResultCacheKeepsCapacity() {
+    for (const size_t capacity : {1u, 5u, 16u, 37u}) {
+        ResultCache cache(capacity);
+        for (TermId term = 0; term < 1'000; ++term) {
+            cache.Insert({term}, {}, DocumentStatus::ACTUAL, 5, 0, {});
+        }
+        ASSERT_EQUAL(cache.GetSize(), capacity);
+    }
+}
+
+void TestResultCacheMatchesSearch() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 500, 7);
+    const auto documents = GenerateQueries(generator, dictionary, 5'000, 25);
+    SearchServer uncached(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        uncached.AddDocument(static_cast<int>(i), documents[i], static_cast<DocumentStatus>(i % 3), {1});
+    }
+    SearchServer cached = uncached;
+    // smaller than the number of distinct queries, so entries get evicted
+    cached.SetResultCacheCapacity(64);
+
+    vector<string> queries;
+    for (int i = 0; i < 200; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 4, 0.2));
+    }
+    for (int i = 0; i < 2'000; ++i) {
+        const string& query = queries[uniform_int_distribution<size_t>(0, queries.size() - 1)(generator)];
+        const auto status = static_cast<DocumentStatus>(i % 2);
+        AssertSameTop(uncached.FindTopDocuments(query, status), cached.FindTopDocuments(query, status));
+        AssertSameTop(uncached.FindTopDocuments(query, status), cached.FindTopDocuments(wand, query, status));
+    }
+    const auto stats = cached.GetResultCacheStats();
+    ASSERT_EQUAL(stats.hits + stats.misses, 4'000u);
+    ASSERT(stats.hits > 0 && stats.misses > 0);
+
+    // queries run in parallel share the cache
+    const auto expected = ProcessQueries(uncached, queries);
+    const auto results = ProcessQueries(cached, queries);
+    ASSERT_EQUAL(results.size(), expected.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        AssertSameTop(expected[i], results[i]);
+    }
+}
+
+void Test_ResultCache() {
+    RUN_TEST(TestResultCacheFollowsChanges);
+    RUN_TEST(TestResultCacheKeepsCapacity);
+    RUN_TEST(TestResultCacheMatchesSearch);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "search_server.h"
+#include "segmented_search_server.h"
+#include "test_Unit.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestSegmentedMatchesSearchServer() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 3'000, 15);
+    const string stop_words = dictionary[0] + " "s + dictionary[1];
+
+    SearchServer search_server(stop_words);
+    SegmentedSearchServer segmented(stop_words, 100);
+    vector<int> live_ids;
+    const auto check = [&] {
+        ASSERT_EQUAL(segmented.GetDocumentCount(), search_server.GetDocumentCount());
+        for (int i = 0; i < 20; ++i) {
+            const string query = GenerateQuery(generator, dictionary, 5, 0.2);
+            AssertSameTop(search_server.FindTopDocuments(query), segmented.FindTopDocuments(query));
+            AssertSameTop(search_server.FindTopDocuments(query), segmented.FindTopDocuments(execution::par, query));
+            AssertSameTop(search_server.FindTopDocuments(query, DocumentStatus::BANNED),
+                          segmented.FindTopDocuments(query, DocumentStatus::BANNED));
+        }
+    };
+
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const int document_id = static_cast<int>(i);
+        const auto status = static_cast<DocumentStatus>(i % 3);
+        const vector<int> ratings = {static_cast<int>(i % 7)};
+        search_server.AddDocument(document_id, documents[i], status, ratings);
+        segmented.AddDocument(document_id, documents[i], status, ratings);
+        live_ids.push_back(document_id);
+
+        // heavy churn, so that merges are started by tombstones as well as by the segment count
+        if (i % 3 != 0) {
+            const size_t index = uniform_int_distribution<size_t>(0, live_ids.size() - 1)(generator);
+            search_server.RemoveDocument(live_ids[index]);
+            segmented.RemoveDocument(live_ids[index]);
+            live_ids.erase(live_ids.begin() + index);
+        }
+        if (i % 500 == 0) {
+            check();
+        }
+    }
+    check();
+    segmented.WaitForMerge();
+    // at most MERGE_FACTOR - 1 segments of each of the tiers of 100, 400 and 1600 documents
+    ASSERT(segmented.GetSegmentCount() <= 3 * (SegmentedSearchServer::MERGE_FACTOR - 1));
+    check();
+}
+
+void TestSegmentedRejectsInvalidChanges() {
+    SegmentedSearchServer segmented("and with"s, 2);
+    segmented.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    segmented.AddDocument(2, "funny pet and rat"s, DocumentStatus::ACTUAL, {2});
+    ASSERT_EQUAL(segmented.GetSegmentCount(), 1u);
+
+    bool thrown = false;
+    try {
+        segmented.AddDocument(1, "curly pet"s, DocumentStatus::ACTUAL, {1});
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    thrown = false;
+    try {
+        segmented.RemoveDocument(3);
+    } catch (const out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    segmented.RemoveDocument(1);
+    ASSERT(segmented.FindTopDocuments("curly"s).empty());
+    ASSERT(segmented.FindTopDocuments("and"s).empty());
+    ASSERT_EQUAL(segmented.FindTopDocuments("pet -cat"s).size(), 1u);
+    ASSERT_EQUAL(segmented.GetDocumentCount(), 1);
+}
+
+void TestSegmentedMergesTiers() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 6'400, 10);
+    SegmentedSearchServer segmented(""s, 100);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        segmented.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+    }
+    // 64 sealed segments are merged by fours into 16, 4 and finally 1
+    segmented.WaitForMerge();
+    ASSERT_EQUAL(segmented.GetSegmentCount(), 1u);
+    ASSERT_EQUAL(segmented.GetDocumentCount(), 6'400);
+
+    for (int document_id = 0; document_id < 6'400; document_id += 2) {
+        segmented.RemoveDocument(document_id);
+    }
+    segmented.RemoveDocument(1);
+    segmented.WaitForMerge();
+    ASSERT_EQUAL(segmented.GetSegmentCount(), 1u);
+    for (const Document& document : segmented.FindTopDocuments(documents[3])) {
+        ASSERT(document.id % 2 == 1 && document.id != 1);
+    }
+}
+
+void Test_SegmentedSearchServer() {
+    RUN_TEST(TestSegmentedMatchesSearchServer);
+    RUN_TEST(TestSegmentedMergesTiers);
+    RUN_TEST(TestSegmentedRejectsInvalidChanges);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "test_Unit.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestShardedMatchesSearchServer() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 2'000, 15);
+    const string stop_words = dictionary[0] + " "s + dictionary[1];
+
+    SearchServer search_server(stop_words);
+    ShardedSearchServer sharded(stop_words, 5);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const auto status = static_cast<DocumentStatus>(i % 3);
+        search_server.AddDocument(static_cast<int>(i), documents[i], status, {static_cast<int>(i % 7)});
+        sharded.AddDocument(static_cast<int>(i), documents[i], status, {static_cast<int>(i % 7)});
+    }
+    for (int document_id = 0; document_id < 2'000; document_id += 3) {
+        search_server.RemoveDocument(document_id);
+        sharded.RemoveDocument(document_id);
+    }
+    ASSERT_EQUAL(sharded.GetDocumentCount(), search_server.GetDocumentCount());
+
+    const auto odd_ids = [](int document_id, DocumentStatus, int) { return document_id % 2 == 1; };
+    for (int i = 0; i < 100; ++i) {
+        const string query = GenerateQuery(generator, dictionary, 6, 0.2);
+        AssertSameTop(search_server.FindTopDocuments(query), sharded.FindTopDocuments(query));
+        AssertSameTop(search_server.FindTopDocuments(query, DocumentStatus::BANNED),
+                      sharded.FindTopDocuments(query, DocumentStatus::BANNED));
+        AssertSameTop(search_server.FindTopDocuments(execution::seq, query, odd_ids, 20),
+                      sharded.FindTopDocuments(query, odd_ids, 20));
+
+        const int document_id = 3 * uniform_int_distribution(0, 666)(generator) + 1;
+        ASSERT(search_server.MatchDocument(query, document_id) == sharded.MatchDocument(query, document_id));
+    }
+}
+
+void TestShardedUpdatesDuringQueries() {
+    ShardedSearchServer sharded("and with"s, 4);
+    atomic<bool> done = false;
+    thread reader([&] {
+        while (!done) {
+            const auto found = sharded.FindTopDocuments("cat"s);
+            ASSERT(found.size() <= MAX_RESULT_DOCUMENT_COUNT);
+        }
+    });
+    for (int id = 0; id < 500; ++id) {
+        sharded.AddDocument(id, "cat and dog "s + to_string(id), DocumentStatus::ACTUAL, {id});
+        if (id % 2 == 0) {
+            sharded.RemoveDocument(id / 2);
+        }
+    }
+    done = true;
+    reader.join();
+    ASSERT_EQUAL(sharded.GetDocumentCount(), 250);
+}
+
+void Test_ShardedSearchServer() {
+    RUN_TEST(TestShardedMatchesSearchServer);
+    RUN_TEST(TestShardedUpdatesDuringQueries);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <random>
+#include <stdexcept>
+
+#include "process_queries.h"
+#include "search_server.h"
+#include "test_Unit.h"
+#include "thread_pool.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestThreadPoolRunsEveryIndex() {
+    ThreadPoolOptions options;
+    options.thread_count = 4;
+    options.pin_threads = true;
+    ThreadPool pool(options);
+    ASSERT_EQUAL(pool.GetThreadCount(), 4u);
+
+    for (const size_t size : {0u, 1u, 7u, 1'000u, 100'000u}) {
+        vector<atomic<int>> visits(size);
+        pool.ParallelFor(0, size, [&visits](size_t i) {
+            visits[i].fetch_add(1, memory_order_relaxed);
+        });
+        for (const auto& visit_count : visits) {
+            ASSERT_EQUAL(visit_count.load(), 1);
+        }
+    }
+
+    // a loop nested in a task runs on the same threads
+    atomic<size_t> sum = 0;
+    pool.ParallelFor(0, 64, [&pool, &sum](size_t i) {
+        pool.ParallelFor(0, 100, [&sum, i](size_t j) {
+            sum.fetch_add(i * j, memory_order_relaxed);
+        });
+    });
+    ASSERT_EQUAL(sum.load(), (64u * 63u / 2) * (100u * 99u / 2));
+
+    bool thrown = false;
+    try {
+        pool.ParallelFor(0, 1'000, [](size_t i) {
+            if (i == 500) {
+                throw out_of_range("500"s);
+            }
+        });
+    } catch (const out_of_range&) {
+        thrown = true;
+    }
+    ASSERT_HINT(thrown, "exception of a task must reach the caller"s);
+}
+
+void TestParallelPathsOnThreadPool() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 500, 7);
+    const auto documents = GenerateQueries(generator, dictionary, 20'000, 20);
+    vector<string> queries;
+    for (int i = 0; i < 100; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 5, 0.1));
+    }
+
+    ThreadPoolOptions options;
+    options.thread_count = 4;
+    ThreadPool::ConfigureDefault(options);
+    ASSERT_EQUAL(ThreadPool::GetDefault().GetThreadCount(), 4u);
+
+    vector<DocumentToAdd> batch;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.push_back({static_cast<int>(i), documents[i], static_cast<DocumentStatus>(i % 2), {1}});
+    }
+    SearchServer seq_server(dictionary[0]);
+    seq_server.AddDocuments(execution::seq, batch);
+    SearchServer par_server(dictionary[0]);
+    par_server.AddDocuments(execution::par, batch);
+
+    const auto results = ProcessQueries(par_server, queries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        AssertSameTop(seq_server.FindTopDocuments(queries[i]), results[i]);
+        AssertSameTop(seq_server.FindTopDocuments(execution::seq, queries[i], DocumentStatus::IRRELEVANT),
+                      par_server.FindTopDocuments(execution::par, queries[i], DocumentStatus::IRRELEVANT));
+        const int document_id = static_cast<int>(i * 7);
+        ASSERT(seq_server.MatchDocument(queries[i], document_id)
+               == par_server.MatchDocument(execution::par, queries[i], document_id));
+    }
+    for (int document_id = 0; document_id < 1'000; document_id += 3) {
+        seq_server.RemoveDocument(execution::seq, document_id);
+        par_server.RemoveDocument(execution::par, document_id);
+    }
+    for (const string& query : queries) {
+        AssertSameTop(seq_server.FindTopDocuments(query), par_server.FindTopDocuments(execution::par, query));
+    }
+
+    ThreadPool::ConfigureDefault({});
+}
+
+void Test_ThreadPool() {
+    RUN_TEST(TestThreadPoolRunsEveryIndex);
+    RUN_TEST(TestParallelPathsOnThreadPool);
+}
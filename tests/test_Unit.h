@@ -4,46 +4,14 @@
 // макросы
 #pragma once
 
+#include <cstdint>
+#include <random>
+
 #include "search_server.h"
 
 
 using namespace std;
 
-void AssertPrint(const bool& flag, const string& str, const string& func_name, const string& file_name, int line_number, const string& hint) {
-    if(flag == false){
-        cout << file_name << "("s << line_number << "): "s;
-        cout << func_name << ": "s ;
-        cout << "ASSERT("s << str << ") failed."s;
-        if (!hint.empty()) {
-            cout << " Hint: "s << hint;
-        }
-        cout << endl;
-        abort();
-    }
-}
-
-template <typename T, typename U>
-void AssertEqualImpl(const T& t, const U& u, const string& t_str, const string& u_str, const string& file,
-                     const string& func, unsigned line, const string& hint) {
-    if (t != u) {
-        cout << boolalpha;
-        cout << file << "("s << line << "): "s << func << ": "s;
-        cout << "ASSERT_EQUAL("s << t_str << ", "s << u_str << ") failed: "s;
-        cout << t << " != "s << u << "."s;
-        if (!hint.empty()) {
-            cout << " Hint: "s << hint;
-        }
-        cout << endl;
-        abort();
-    }
-}
-
-template <typename Type>
-void RunTestImpl(const Type& func, const string& str) {
-    func();
-    cerr << str << " OK" << endl;
-}
-
 // For cheking and printing containers
 
 template<typename First, typename Second>
@@ -51,6 +19,10 @@ ostream &operator<<(ostream &out, const pair<First, Second> &p) {
     return out << p.first << ": "s << p.second;
 }
 
+// declared ahead, so that nested containers are printed too
+template<typename Element>
+ostream &operator<<(ostream &out, const vector<Element> &container);
+
 template<typename Document>
 void Print(ostream &out, const Document &container) {
     bool first = true;
@@ -89,6 +61,41 @@ ostream &operator<<(ostream &out, const map<Key, Value> &container) {
 }
 
 
+void AssertPrint(const bool& flag, const string& str, const string& func_name, const string& file_name, int line_number, const string& hint) {
+    if(flag == false){
+        cout << file_name << "("s << line_number << "): "s;
+        cout << func_name << ": "s ;
+        cout << "ASSERT("s << str << ") failed."s;
+        if (!hint.empty()) {
+            cout << " Hint: "s << hint;
+        }
+        cout << endl;
+        abort();
+    }
+}
+
+template <typename T, typename U>
+void AssertEqualImpl(const T& t, const U& u, const string& t_str, const string& u_str, const string& file,
+                     const string& func, unsigned line, const string& hint) {
+    if (t != u) {
+        cout << boolalpha;
+        cout << file << "("s << line << "): "s << func << ": "s;
+        cout << "ASSERT_EQUAL("s << t_str << ", "s << u_str << ") failed: "s;
+        cout << t << " != "s << u << "."s;
+        if (!hint.empty()) {
+            cout << " Hint: "s << hint;
+        }
+        cout << endl;
+        abort();
+    }
+}
+
+template <typename Type>
+void RunTestImpl(const Type& func, const string& str) {
+    func();
+    cerr << str << " OK" << endl;
+}
+
 #define ASSERT(expr) AssertPrint((expr), #expr, __FUNCTION__, __FILE__, __LINE__, ""s)
 
 #define ASSERT_HINT(expr, hint) AssertPrint((expr), #expr, __FUNCTION__, __FILE__, __LINE__, (hint))
@@ -99,6 +106,15 @@ ostream &operator<<(ostream &out, const map<Key, Value> &container) {
 
 #define RUN_TEST(expr)  RunTestImpl((expr), #expr)
 
+// Ties inside EPSILON may come in any order, so only relevance and rating are compared rank by rank
+void AssertSameTop(const vector<Document>& expected, const vector<Document>& actual) {
+    ASSERT_EQUAL(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT(abs(expected[i].relevance - actual[i].relevance) < EPSILON);
+        ASSERT_EQUAL(expected[i].rating, actual[i].rating);
+    }
+}
+
 // -------- Начало модульных тестов поисковой системы ----------
 
 // Тест проверяет, что поисковая система исключает стоп-слова при добавлении документов
@@ -231,6 +247,127 @@ void TestDocumentsStatus() {
     ASSERT_EQUAL_HINT(search_server.FindTopDocuments("скворец"s, DocumentStatus::BANNED).size(),  1, "Document status test ERROR for BANNED"s);
 }
 
+// Тест. Удаление документа не портит слова, которые он делит с другими документами
+void TestRemoveDocumentKeepsSharedWords() {
+    SearchServer search_server("and with"s);
+
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {2});
+    search_server.RemoveDocument(1);
+
+    ASSERT_EQUAL(search_server.FindTopDocuments("funny"s).size(), 1u);
+    const auto [words, status] = search_server.MatchDocument("funny pet -rat"s, 2);
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT_EQUAL(string(words[0]), "funny"s);
+    ASSERT_EQUAL(search_server.GetWordFrequencies(2).count("pet"sv), 1u);
+}
+
+// Тест. Документ, добавленный после удаления, не наследует данные удалённого
+void TestAddAfterRemove() {
+    SearchServer search_server("and with"s);
+
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::BANNED, {5});
+    search_server.AddDocument(2, "curly hair"s, DocumentStatus::ACTUAL, {1});
+    search_server.RemoveDocument(1);
+    search_server.AddDocument(7, "curly pet"s, DocumentStatus::ACTUAL, {3});
+
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+    ASSERT(search_server.FindTopDocuments("rat"s, DocumentStatus::BANNED).empty());
+    const auto found = search_server.FindTopDocuments("pet"s);
+    ASSERT_EQUAL(found.size(), 1u);
+    ASSERT_EQUAL(found[0].id, 7);
+    ASSERT_EQUAL(found[0].rating, 3);
+    ASSERT_EQUAL(search_server.GetWordFrequencies(7).size(), 2u);
+    ASSERT_EQUAL(vector<int>(search_server.begin(), search_server.end()), (vector<int>{2, 7}));
+}
+
+// Тест. После удаления документов релевантность та же, что у сервера, собранного заново
+void TestTermStatsFollowRemovals() {
+    const vector<string> documents = {"white cat and fancy collar"s, "fluffy cat fluffy tail"s,
+                                      "groomed dog expressive eyes"s, "groomed starling evgeny"s,
+                                      "cat cat cat"s};
+    SearchServer search_server("and with"s);
+    SearchServer rebuilt("and with"s);
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {id});
+        if (id != 1 && id != 4) {
+            rebuilt.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {id});
+        }
+    }
+    search_server.RemoveDocument(4);
+    search_server.RemoveDocument(execution::par, 1);
+
+    for (const string& query : {"fluffy groomed cat"s, "cat -collar"s, "evgeny dog"s}) {
+        AssertSameTop(rebuilt.FindTopDocuments(query), search_server.FindTopDocuments(query));
+        AssertSameTop(rebuilt.FindTopDocuments(query), search_server.FindTopDocuments(wand, query));
+    }
+}
+
+// Тест. Разбиение на слова совпадает с посимвольным, управляющие символы находятся за тот же проход
+void TestSplitIntoWordsChecked() {
+    const auto split_naive = [](string_view text) {
+        vector<string_view> words;
+        for (size_t pos = 0; pos != text.npos; text.remove_prefix(pos + 1)) {
+            pos = text.find(' ');
+            words.push_back(text.substr(0, pos));
+        }
+        return words;
+    };
+
+    mt19937 generator;
+    const string alphabet = "ab  \xff\x80-"s;
+    vector<string_view> words;
+    for (int length = 0; length < 200; ++length) {
+        string text;
+        for (int i = 0; i < length; ++i) {
+            text += alphabet[uniform_int_distribution<size_t>(0, alphabet.size() - 1)(generator)];
+        }
+        ASSERT_EQUAL(SplitIntoWordsChecked(text, words), string_view::npos);
+        ASSERT(words == split_naive(text));
+
+        if (length > 0) {
+            const size_t control_position = uniform_int_distribution<size_t>(0, text.size() - 1)(generator);
+            text[control_position] = static_cast<char>(uniform_int_distribution<int>(0, 31)(generator));
+            text += '\x01';
+            ASSERT_EQUAL(SplitIntoWordsChecked(text, words), control_position);
+            ASSERT(words == split_naive(text));
+        }
+    }
+    ASSERT_EQUAL(SplitIntoWords("  curly   cat "s), (vector<string>{"curly"s, "cat"s}));
+}
+
+// Тест. Количество результатов задаётся вызывающим, лучшие документы идут первыми
+void TestResultCount() {
+    SearchServer search_server("and with"s);
+    for (int id = 0; id < 20; ++id) {
+        search_server.AddDocument(id, "cat"s + string(id % 7 + 1, 's') + " cat tail"s, DocumentStatus::ACTUAL, {id % 3});
+    }
+
+    const auto top = search_server.FindTopDocuments(execution::seq, "cat tail"s, DocumentStatus::ACTUAL, 12);
+    ASSERT_EQUAL(top.size(), 12u);
+    ASSERT(is_sorted(top.begin(), top.end(), IsMoreRelevant));
+
+    const auto par_top = search_server.FindTopDocuments(execution::par, "cat tail"s, DocumentStatus::ACTUAL, 12);
+    ASSERT_EQUAL(par_top.size(), 12u);
+    for (size_t i = 0; i < top.size(); ++i) {
+        ASSERT_EQUAL(top[i].id, par_top[i].id);
+    }
+
+    const auto default_top = search_server.FindTopDocuments("cat tail"s);
+    ASSERT_EQUAL(default_top.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    for (size_t i = 0; i < default_top.size(); ++i) {
+        ASSERT_EQUAL(top[i].id, default_top[i].id);
+    }
+
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::seq, "cat"s,
+                                                [](int document_id, DocumentStatus, int) { return document_id < 3; },
+                                                100).size(), 3u);
+    ASSERT(search_server.FindTopDocuments(execution::par, "cat"s, DocumentStatus::ACTUAL, 0).empty());
+    // the count is a bound, nothing of that size is allocated
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::seq, "cat"s, DocumentStatus::ACTUAL, SIZE_MAX).size(), 20u);
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "cat"s, DocumentStatus::ACTUAL, SIZE_MAX).size(), 20u);
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
@@ -240,6 +377,11 @@ void TestSearchServer() {
     RUN_TEST(TestPredicate);
     RUN_TEST(TestCorrectRelevance);
     RUN_TEST(TestDocumentsStatus);
+    RUN_TEST(TestRemoveDocumentKeepsSharedWords);
+    RUN_TEST(TestAddAfterRemove);
+    RUN_TEST(TestResultCount);
+    RUN_TEST(TestTermStatsFollowRemovals);
+    RUN_TEST(TestSplitIntoWordsChecked);
     // Не забудьте вызывать остальные тесты здесь
 }
 
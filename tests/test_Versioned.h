@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "search_server.h"
+#include "test_Unit.h"
+#include "versioned_search_server.h"
+
+using namespace std;
+
+void TestVersionedChangesAreAtomic() {
+    VersionedSearchServer search_server(SearchServer("and with"s));
+    search_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    {
+        const auto snapshot = search_server.GetSnapshot();
+        ASSERT_EQUAL(snapshot->GetDocumentCount(), 1);
+    }
+
+    bool thrown = false;
+    try {
+        search_server.AddDocument(1, "funny pet"s, DocumentStatus::ACTUAL, {1});
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    search_server.AddDocuments({{2, "funny pet"s, DocumentStatus::ACTUAL, {2}},
+                                {3, "curly pet"s, DocumentStatus::ACTUAL, {3}}});
+    search_server.RemoveDocument(1);
+
+    // both copies of the index went through the same changes
+    for (int i = 0; i < 2; ++i) {
+        {
+            const auto snapshot = search_server.GetSnapshot();
+            ASSERT_EQUAL(snapshot->GetDocumentCount(), 2 + i);
+            ASSERT_EQUAL(snapshot->FindTopDocuments("curly"s).size(), 1u);
+            ASSERT_EQUAL(snapshot->FindTopDocuments("pet"s).size(), 2u);
+        }
+        // a writer waits for the snapshots of the previous version, so none is held here
+        search_server.AddDocument(10 + i, "nasty rat"s, DocumentStatus::BANNED, {});
+    }
+}
+
+void TestVersionedReadsDuringWrites() {
+    VersionedSearchServer search_server(SearchServer("and with"s));
+    atomic<bool> done = false;
+    atomic<int> inconsistent = 0;
+
+    vector<thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&] {
+            while (!done) {
+                // every document has the word "cat", a half-applied change would show up in the counts
+                const auto snapshot = search_server.GetSnapshot();
+                const auto found = snapshot->FindTopDocuments(execution::seq, "cat"s, DocumentStatus::ACTUAL, 1'000);
+                if (static_cast<int>(found.size()) != snapshot->GetDocumentCount()) {
+                    ++inconsistent;
+                }
+            }
+        });
+    }
+
+    for (int id = 0; id < 300; ++id) {
+        search_server.AddDocument(id, "cat number "s + to_string(id), DocumentStatus::ACTUAL, {id});
+        if (id % 3 == 0) {
+            search_server.RemoveDocument(id / 3);
+        }
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQUAL(inconsistent.load(), 0);
+    ASSERT_EQUAL(search_server.GetSnapshot()->GetDocumentCount(), 200);
+}
+
+void Test_VersionedSearchServer() {
+    RUN_TEST(TestVersionedChangesAreAtomic);
+    RUN_TEST(TestVersionedReadsDuringWrites);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "search_server.h"
+#include "test_Unit.h"
+#include "words_generator.h"
+
+using namespace std;
+
+void TestWandMatchesExhaustiveSearch() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 200, 5);
+    const auto documents = GenerateQueries(generator, dictionary, 3'000, 15);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i],
+                                  static_cast<DocumentStatus>(i % 3),
+                                  {uniform_int_distribution(-3, 3)(generator)});
+    }
+    // removals leave the per-term maxima stale, the bounds must still hold
+    for (int id = 0; id < 3'000; id += 7) {
+        search_server.RemoveDocument(id);
+    }
+
+    const auto odd_ids = [](int document_id, DocumentStatus, int) { return document_id % 2 == 1; };
+    for (int i = 0; i < 100; ++i) {
+        const string query = GenerateQuery(generator, dictionary, 5, 0.15);
+        AssertSameTop(search_server.FindTopDocuments(query), search_server.FindTopDocuments(wand, query));
+        AssertSameTop(search_server.FindTopDocuments(execution::seq, query, DocumentStatus::IRRELEVANT, 50),
+                      search_server.FindTopDocuments(wand, query, DocumentStatus::IRRELEVANT, 50));
+        AssertSameTop(search_server.FindTopDocuments(execution::seq, query, odd_ids, 1),
+                      search_server.FindTopDocuments(wand, query, odd_ids, 1));
+    }
+}
+
+void TestWandSkipsPostings() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 1'000, 5);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 30);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+    }
+
+    const auto count_scanned = [&search_server](const auto& policy, const vector<string>& queries) {
+        Metrics::Reset();
+        Metrics::SetEnabled(true);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(policy, query);
+        }
+        Metrics::SetEnabled(false);
+        return Metrics::GetSnapshot()[MetricsCounter::POSTINGS_SCANNED];
+    };
+    const auto queries = GenerateQueries(generator, dictionary, 100, 5);
+    const uint64_t exhaustive = count_scanned(execution::seq, queries);
+    const uint64_t pruned = count_scanned(wand, queries);
+    Metrics::Reset();
+    ASSERT_HINT(pruned * 2 < exhaustive, "WAND should read well under half of the postings");
+}
+
+void Test_Wand() {
+    RUN_TEST(TestWandMatchesExhaustiveSearch);
+    RUN_TEST(TestWandSkipsPostings);
+}